@@ -0,0 +1,361 @@
+/** @file BenchVoting.c++
+ *  @brief Contains the main() function of the benchmark suite.
+ *
+ *  Times parsing, the first count, elimination, whole solves and OnlineElection batches on seeded
+ *  synthetic elections, reporting ballots per second, peak heap and bytes per ballot for each.
+ *  With --generate it writes a synthetic election in the RunVoting.in text format instead.
+ */
+
+// --------
+// includes
+// --------
+
+#include <algorithm> // min
+#include <atomic>    // atomic
+#include <cstdio>    // remove
+#include <cstdlib>   // atoi, atof, malloc, free, strtoull
+#include <fstream>   // ofstream
+#include <iostream>  // cerr, cout
+#include <new>       // bad_alloc
+#include <sstream>   // ostringstream
+#include <string>    // string
+#include <thread>    // thread
+#include <vector>    // vector
+
+#include <benchmark/benchmark.h>
+
+#include "Voting.h"
+
+using namespace std;
+
+// ----
+// heap
+// ----
+
+// every allocation carries its size in front, so the live total and its peak
+// can be tracked without asking the allocator
+static atomic<long long> heap_current(0);
+static atomic<long long> heap_peak(0);
+static const size_t heap_header = 16;
+
+// the replaced operators only call these, kept out of line so the compiler
+// never sees a pointer from operator new reach free() and warn about it
+static void* heap_allocate (size_t size) __attribute__((noinline));
+static void heap_release (void* q) __attribute__((noinline));
+
+static void* heap_allocate (size_t size) {
+    char* p = static_cast<char*>(malloc(size + heap_header));
+    if(p == 0)
+    {
+        return 0;
+    }
+    *reinterpret_cast<size_t*>(p) = size;
+    long long now = heap_current += size;
+    long long peak = heap_peak;
+    while(now > peak && !heap_peak.compare_exchange_weak(peak, now))
+    {
+    }
+    return p + heap_header;}
+
+static void heap_release (void* q) {
+    char* p = static_cast<char*>(q) - heap_header;
+    heap_current -= *reinterpret_cast<size_t*>(p);
+    free(p);}
+
+void* operator new (size_t size) {
+    void* p = heap_allocate(size);
+    if(p == 0)
+    {
+        throw bad_alloc();
+    }
+    return p;}
+
+void operator delete (void* q) noexcept {
+    if(q != 0)
+    {
+        heap_release(q);
+    }}
+
+void* operator new[] (size_t size) {
+    return operator new(size);}
+
+void operator delete[] (void* q) noexcept {
+    operator delete(q);}
+
+// the peak is measured from whatever was live when the benchmark started
+static long long heap_reset () {
+    heap_peak = heap_current.load();
+    return heap_current;}
+
+static void heap_report (benchmark::State& state, long long base, int ballots) {
+    state.counters["peak_heap"] = heap_peak - base;
+    state.counters["bytes_per_ballot"] = ballots == 0 ? 0 : (double)(heap_peak - base) / ballots;}
+
+// -----
+// input
+// -----
+
+static const char* const distributions[] = {"uniform", "clustered", "adversarial", "tied"};
+
+// the text goes to a file ballot by ballot and is read back through a MappedFile,
+// so not even 1e8 ballots are ever held as text in memory
+static const char* const generated = "BenchVoting.tmp";
+
+static void generate_file (int n, int ballots, int distribution) {
+    ofstream w(generated, ios::binary);
+    voting_generate(w, 1, n, ballots, distributions[distribution], 371);}
+
+static vector<Candidate> generate_candidates (int n) {
+    vector<Candidate> candidates;
+    for(int i = 1; i <= n; ++i)
+    {
+        candidates.push_back(Candidate("Candidate " + to_string(i), i));
+    }
+    return candidates;}
+
+// ----------
+// benchmarks
+// ----------
+
+/**
+ * parse one mapped case of n candidates and the given number of ballots into a BallotStore
+ */
+static void BM_parse (benchmark::State& state, int n, int ballots, int distribution) {
+    generate_file(n, ballots, distribution);
+    MappedFile file(generated);
+    const char* first = find(file.begin(), file.end(), '\n') + 1;
+    long long base = heap_reset();
+    for(auto _ : state)
+    {
+        vector<Candidate> candidates;
+        BallotStore store(1);
+        benchmark::DoNotOptimize(voting_scan_case(file.begin(), first, file.end(), candidates, store));
+    }
+    state.SetItemsProcessed(state.iterations() * ballots);
+    state.SetBytesProcessed(state.iterations() * (file.end() - file.begin()));
+    heap_report(state, base, ballots);
+    remove(generated);}
+
+/**
+ * count first preferences across the given number of shards
+ */
+static void BM_first_count (benchmark::State& state, int n, int ballots, int distribution, int shards) {
+    BallotStore store(n);
+    voting_generate(store, ballots, distributions[distribution], 371);
+    vector<Candidate> candidates = generate_candidates(n);
+    long long base = heap_reset();
+    for(auto _ : state)
+    {
+        voting_count(candidates, store, shards);
+        benchmark::DoNotOptimize(candidates.data());
+    }
+    state.SetItemsProcessed(state.iterations() * ballots);
+    heap_report(state, base, ballots);}
+
+/**
+ * run every round of elimination, from the first count to the winners
+ */
+static void BM_eliminate (benchmark::State& state, int n, int ballots, int distribution) {
+    BallotStore store(n);
+    voting_generate(store, ballots, distributions[distribution], 371);
+    vector<Candidate> candidates = generate_candidates(n);
+    voting_count(candidates, store, 1);
+    long long base = heap_reset();
+    for(auto _ : state)
+    {
+        benchmark::DoNotOptimize(voting_eval(candidates, store));
+        state.PauseTiming();
+        store.rewind();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * ballots);
+    heap_report(state, base, ballots);}
+
+/**
+ * run every round of elimination on the original vector of Ballot, for comparison
+ */
+static void BM_eliminate_ballots (benchmark::State& state, int n, int ballots, int distribution) {
+    BallotStore store(n);
+    voting_generate(store, ballots, distributions[distribution], 371);
+    vector<Ballot> votes;
+    for(int b = 0; b < store.size(); ++b)
+    {
+        vector<int> preference;
+        for(int r = 0; r < n; ++r)
+        {
+            preference.push_back(store.get_rank(b, r));
+        }
+        votes.push_back(Ballot(preference));
+    }
+    vector<Candidate> candidates = generate_candidates(n);
+    voting_count(candidates, store, 1);
+    long long base = heap_reset();
+    for(auto _ : state)
+    {
+        benchmark::DoNotOptimize(voting_eval(candidates, votes));
+    }
+    state.SetItemsProcessed(state.iterations() * ballots);
+    heap_report(state, base, ballots);}
+
+/**
+ * map, parse, eliminate and print a whole input file, as RunVoting does
+ */
+static void BM_solve (benchmark::State& state, int n, int ballots, int distribution) {
+    generate_file(n, ballots, distribution);
+    long long bytes = 0;
+    {
+        MappedFile file(generated);
+        bytes = file.end() - file.begin();
+    }
+    long long base = heap_reset();
+    for(auto _ : state)
+    {
+        ostringstream w;
+        voting_solve_file(generated, w);
+        benchmark::DoNotOptimize(w.str().size());
+    }
+    state.SetItemsProcessed(state.iterations() * ballots);
+    state.SetBytesProcessed(state.iterations() * bytes);
+    heap_report(state, base, ballots);
+    remove(generated);}
+
+static vector< vector<int> > generate_batch (int n, int ballots, int distribution, int seed) {
+    BallotStore store(n);
+    voting_generate(store, ballots, distributions[distribution], seed);
+    vector< vector<int> > batch(store.size());
+    for(int b = 0; b < store.size(); ++b)
+    {
+        for(int r = 0; r < n; ++r)
+        {
+            batch.at(b).push_back(store.get_rank(b, r));
+        }
+    }
+    return batch;}
+
+/**
+ * add a batch of 1000 ballots to an election of the given size and ask for its result
+ */
+static void BM_online (benchmark::State& state, int n, int ballots, int distribution) {
+    vector<string> names;
+    for(int i = 1; i <= n; ++i)
+    {
+        names.push_back("Candidate " + to_string(i));
+    }
+    OnlineElection election(names);
+    int seed = 371;
+    for(int added = 0; added < ballots; added += 100000)
+    {
+        election.add_ballots(generate_batch(n, min(ballots - added, 100000), distribution, seed++));
+    }
+    vector< vector<int> > batch = generate_batch(n, 1000, distribution, seed);
+    election.current_result();
+    int recounts = election.get_recounts();
+    long long base = heap_reset();
+    for(auto _ : state)
+    {
+        election.add_ballots(batch);
+        benchmark::DoNotOptimize(election.current_result());
+    }
+    state.SetItemsProcessed(state.iterations() * batch.size());
+    state.counters["recounts"] = election.get_recounts() - recounts;
+    heap_report(state, base, batch.size());}
+
+// main
+
+int main (int argc, char* argv[]) {
+    long long maxBallots = 1000000;
+    vector<char*> args;
+    args.push_back(argv[0]);
+    for(int i = 1; i < argc; ++i)
+    {
+        string arg(argv[i]);
+        if(arg == "--generate" && i + 4 < argc)
+        {
+            /** --generate n ballots distribution seed writes one case to cout */
+            try
+            {
+                voting_generate(cout, 1, atoi(argv[i + 1]), atoi(argv[i + 2]), argv[i + 3], strtoull(argv[i + 4], 0, 10));
+            }
+            catch(const exception& e)
+            {
+                cerr << "BenchVoting: " << e.what() << endl;
+                return 1;
+            }
+            return 0;
+        }
+        else if(arg.compare(0, 14, "--max_ballots=") == 0)
+        {
+            maxBallots = atof(arg.c_str() + 14); /** up to 1e8; the default of 1e6 fits a laptop */
+        }
+        else
+        {
+            args.push_back(argv[i]);
+        }
+    }
+    int argcLeft = args.size();
+    benchmark::Initialize(&argcLeft, args.data());
+
+    int cores = thread::hardware_concurrency() == 0 ? 1 : thread::hardware_concurrency();
+    //1000 ballots is above (n-1)(n-2)+4 for every size, so the adversarial
+    //elections always take n-1 rounds
+    const int sizes[] = {3, 8, 20};
+    for(long long ballots = 1000; ballots <= maxBallots; ballots *= 10)
+    {
+        for(int s = 0; s < 3; ++s)
+        {
+            for(int d = 0; d < 4; ++d)
+            {
+                int n = sizes[s];
+                string suffix = "/n:" + to_string(n) + "/ballots:" + to_string(ballots) + "/" + distributions[d];
+                benchmark::RegisterBenchmark(("BM_parse" + suffix).c_str(), BM_parse, n, ballots, d)->Unit(benchmark::kMillisecond);
+                benchmark::RegisterBenchmark(("BM_first_count" + suffix + "/shards:1").c_str(), BM_first_count, n, ballots, d, 1)->Unit(benchmark::kMillisecond);
+                if(cores > 1)
+                {
+                    benchmark::RegisterBenchmark(("BM_first_count" + suffix + "/shards:" + to_string(cores)).c_str(), BM_first_count, n, ballots, d, cores)->Unit(benchmark::kMillisecond)->UseRealTime();
+                }
+                benchmark::RegisterBenchmark(("BM_eliminate" + suffix).c_str(), BM_eliminate, n, ballots, d)->Unit(benchmark::kMillisecond);
+                if(ballots <= 100000)
+                {
+                    benchmark::RegisterBenchmark(("BM_eliminate_ballots" + suffix).c_str(), BM_eliminate_ballots, n, ballots, d)->Unit(benchmark::kMillisecond);
+                }
+                benchmark::RegisterBenchmark(("BM_solve" + suffix).c_str(), BM_solve, n, ballots, d)->Unit(benchmark::kMillisecond);
+                benchmark::RegisterBenchmark(("BM_online" + suffix).c_str(), BM_online, n, ballots, d)->Unit(benchmark::kMillisecond);
+            }
+        }
+    }
+    if(benchmark::ReportUnrecognizedArguments(argcLeft, args.data()))
+    {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;}
+
+/*
+% g++ -pedantic -std=c++11 -Wall -O2 Voting.c++ BenchVoting.c++ -o BenchVoting -lbenchmark -pthread
+
+
+
+% BenchVoting --max_ballots=1e4 --benchmark_filter='BM_eliminate/n:8'
+BM_eliminate/n:8/ballots:1000/uniform        0.033 ms        0.033 ms         2155 bytes_per_ballot=9.016 items_per_second=30.6731M/s peak_heap=9.016k
+
+
+
+% BenchVoting --benchmark_out=BenchVoting.json --benchmark_out_format=json
+
+
+
+% BenchVoting --generate 5 20 adversarial 1
+1
+
+5
+Candidate 1
+Candidate 2
+Candidate 3
+Candidate 4
+Candidate 5
+1 5 2 3 4
+4 5 1 2 3
+2 5 1 3 4
+...
+*/
@@ -0,0 +1,77 @@
+/** @file ConvertVoting.c++
+ *  @brief Contains the main() function of the ballot file converter.
+ *   
+ *  Converts input in the RunVoting.in text format to a binary ballot file, and back.
+ */
+
+// --------
+// includes
+// --------
+
+#include <cstring>   // strcmp
+#include <exception> // exception
+#include <fstream>   // ifstream, ofstream
+#include <iostream>  // cerr
+#include <iterator>  // istreambuf_iterator
+#include <stdexcept> // runtime_error
+#include <string>    // string
+
+#include "Voting.h"
+
+// main 
+
+int main (int argc, char* argv[]) {
+    using namespace std;
+    if(argc != 4 || (strcmp(argv[1], "encode") != 0 && strcmp(argv[1], "decode") != 0))
+    {
+        cerr << "usage: ConvertVoting encode|decode input output" << endl;
+        return 2;
+    }
+    try
+    {
+        ifstream r(argv[2], ios::binary);
+        if(!r)
+        {
+            throw runtime_error(string("cannot open ") + argv[2]);
+        }
+        string input((istreambuf_iterator<char>(r)), istreambuf_iterator<char>());
+        ofstream w(argv[3], ios::binary);
+        if(!w)
+        {
+            throw runtime_error(string("cannot open ") + argv[3]);
+        }
+        if(strcmp(argv[1], "encode") == 0)
+        {
+            voting_encode(input.data(), input.data() + input.size(), w); /** text to binary */
+        }
+        else
+        {
+            voting_decode(input.data(), input.data() + input.size(), w); /** binary to text */
+        }
+        if(!w.flush())
+        {
+            throw runtime_error(string("cannot write ") + argv[3]);
+        }
+    }
+    catch(const exception& e)
+    {
+        cerr << argv[2] << ": " << e.what() << endl;
+        return 1;
+    }
+    return 0;}
+
+/*
+% g++ -pedantic -std=c++11 -Wall Voting.c++ ConvertVoting.c++ -o ConvertVoting -pthread
+
+
+
+% ConvertVoting encode RunVoting.in RunVoting.votb
+
+
+
+% RunVoting RunVoting.votb > RunVoting.out
+
+
+
+% ConvertVoting decode RunVoting.votb RunVoting.txt
+*/
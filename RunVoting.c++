@@ -8,15 +8,92 @@
 // includes
 // --------
 
-#include <iostream> // cin, cout
+#include <cstdlib>   // atoi
+#include <exception> // exception
+#include <fstream>   // ofstream
+#include <iostream>  // cerr, cin, cout
+#include <iterator>  // istreambuf_iterator
+#include <string>    // string
 
 #include "Voting.h"
 
 // main 
 
-int main () {
+int main (int argc, char* argv[]) {
     using namespace std;
-    voting_solve(cin, cout); /** Voting_solve() defined in Voting.c++ is called with cin, cout as arguments */
+    VotingOptions options;
+    bool speedup = false;
+    bool buffered = false;
+    ofstream trace;
+    const char* path = 0;
+    for(int i = 1; i < argc; ++i)
+    {
+        string arg(argv[i]);
+        buffered = true;
+        if(arg == "--strict")
+        {
+            options.strict = true;
+        }
+        else if(arg == "--aggregate")
+        {
+            options.aggregate = true; /** identical rankings are counted once, with a weight */
+        }
+        else if(arg == "--report")
+        {
+            options.report = &cerr; /** ballot statistics per case go to cerr */
+        }
+        else if(arg == "--trace" && i + 1 < argc)
+        {
+            trace.open(argv[++i]); /** a JSON line per elimination round goes to this file */
+            if(!trace)
+            {
+                cerr << argv[i] << ": cannot open" << endl;
+                return 1;
+            }
+            options.trace = &trace;
+        }
+        else if(arg == "--speedup")
+        {
+            speedup = true;
+        }
+        else if(arg == "-j" && i + 1 < argc)
+        {
+            options.threads = atoi(argv[++i]); /** 0 runs one worker per core */
+        }
+        else if(arg == "-s" && i + 1 < argc)
+        {
+            options.shards = atoi(argv[++i]); /** each case's ballots are tallied by this many threads */
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+    try
+    {
+        if(path != 0 && speedup)
+        {
+            voting_speedup_file(path, cout, options.shards); /** reports the sharded tally's speedup instead of the winners */
+        }
+        else if(path != 0)
+        {
+            voting_solve_file(path, cout, options); /** given a path, the file is mapped and parsed in place */
+        }
+        else if(buffered)
+        {
+            string input((istreambuf_iterator<char>(cin)), istreambuf_iterator<char>());
+            voting_solve_parallel(input.data(), input.data() + input.size(), cout, options);
+        }
+        else
+        {
+            voting_solve(cin, cout); /** Voting_solve() defined in Voting.c++ is called with cin, cout as arguments */
+        }
+    }
+    catch(const exception& e)
+    {
+        cerr << (path != 0 ? path : "RunVoting") << ": " << e.what() << endl;
+        return 1;
+    }
     return 0;}
 
 /*
@@ -36,6 +113,39 @@ int main () {
 
 
 
+% RunVoting RunVoting.in > RunVoting.out
+
+
+
+% RunVoting --strict RunVoting.in
+RunVoting.in: line 34: duplicate ranking in ballot
+
+
+
+% RunVoting -j 4 RunVoting.in > RunVoting.out
+
+
+
+% RunVoting -s 8 RunVoting.in > RunVoting.out
+
+
+
+% RunVoting --aggregate --report RunVoting.in > RunVoting.out
+case 1: 5 ballots, 5 rankings, compression 1, 25.6 bytes per ballot
+
+
+
+% RunVoting --trace RunVoting.trace RunVoting.in > RunVoting.out
+% head -1 RunVoting.trace
+{"case":1,"round":1,"tallies":[{"candidate":"John Doe","votes":2},{"candidate":"Jane Smith","votes":2},{"candidate":"Sirchan Sirchan","votes":1}],"eliminated":["Sirchan Sirchan"],"transferred":1,"skipped":0,"count_seconds":1.864e-05,"transfer_seconds":1.8755e-05}
+
+
+
+% RunVoting --speedup -s 8 RunVoting.in
+case 1: 5 ballots, 5 shards, speedup 0.0894741
+
+
+
 % cat RunVoting.out
 1 10 1
 100 200 1
@@ -15,8 +15,10 @@
 // includes
 // --------
 
+#include <algorithm> // count
 #include <iostream> // cout, endl
 #include <sstream>  // istringtstream, ostringstream
+#include <stdexcept> // out_of_range
 #include <string>   // string
 #include <utility>  // pair
 
@@ -115,6 +117,101 @@ TEST(VotingFixture, eval_3) {
 }
 
 
+TEST(VotingFixture, eval_4) {
+    vector <Candidate> candidates;
+    vector <Ballot> ballots;
+    candidates.push_back(Candidate("John Doe", 1));
+    candidates.push_back(Candidate("Jane Smith", 2));
+    candidates.push_back(Candidate("Sirchan Sirchan", 3));
+    candidates.push_back(Candidate("Potato Joe", 4));
+    const char* lines[] = {"1 2 3 4", "1 2 3 4", "1 2 3 4", "2 3 4 1", "2 3 4 1",
+                           "3 4 2 1", "3 2 4 1", "4 3 2 1"};
+    for(int i = 0; i < 8; ++i)
+    {
+        ballots.push_back(Ballot(voting_read(lines[i], 4)));
+        candidates.at(ballots.back().get_preference()-1).increase();
+    }
+    vector<string> candidate_names = voting_eval (candidates, ballots);
+    ASSERT_EQ( 1, candidate_names.size());
+    ASSERT_EQ( "Sirchan Sirchan", candidate_names.at(0));
+}
+
+
+// -----
+// ballot store
+// -----
+
+TEST(VotingFixture, store_1) {
+    BallotStore ballots(3);
+    ballots.add(voting_read("2 3 1", 3));
+    ballots.add(voting_read("3 1 2", 3));
+    ASSERT_EQ( 2, ballots.size());
+    ASSERT_EQ( 2, ballots.get_preference(0));
+    ASSERT_EQ( 3, ballots.get_preference(1));
+    ASSERT_EQ( 3, ballots.next_preference(0));
+    ASSERT_EQ( 1, ballots.next_preference(0));
+    ASSERT_EQ( 3, ballots.get_preference(1));
+    ASSERT_THROW(ballots.next_preference(0), out_of_range);
+    ballots.rewind();
+    ASSERT_EQ( 2, ballots.get_preference(0));
+}
+
+TEST(VotingFixture, store_2) {
+    BallotStore ballots(4);
+    ASSERT_THROW(ballots.add(voting_read("1 2 300 4", 4)), out_of_range);
+    ASSERT_THROW(BallotStore(0), out_of_range);
+}
+
+TEST(VotingFixture, store_3) {
+    BallotStore ballots(20);
+    ballots.reserve(1000);
+    for(int i = 0; i < 1000; ++i)
+    {
+        ballots.add(voting_read("1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20", 20));
+    }
+    ASSERT_EQ( 21, ballots.bytes_per_ballot());
+}
+
+TEST(VotingFixture, store_eval) {
+    vector <Candidate> candidates;
+    candidates.push_back(Candidate("John Doe", 1));
+    candidates.push_back(Candidate("Jane Smith", 2));
+    candidates.push_back(Candidate("Sirchan Sirchan", 3));
+    candidates.push_back(Candidate("Potato Joe", 4));
+    BallotStore ballots(4);
+    const char* lines[] = {"1 2 3 4", "1 2 3 4", "1 2 3 4", "2 3 4 1", "2 3 4 1",
+                           "3 4 2 1", "3 2 4 1", "4 3 2 1"};
+    for(int i = 0; i < 8; ++i)
+    {
+        ballots.add(voting_read(lines[i], 4));
+        candidates.at(ballots.get_preference(i)-1).increase();
+    }
+    vector<string> candidate_names = voting_eval (candidates, ballots);
+    ASSERT_EQ( 1, candidate_names.size());
+    ASSERT_EQ( "Sirchan Sirchan", candidate_names.at(0));
+    ASSERT_EQ( 3, ballots.get_preference(3));
+}
+
+TEST(VotingFixture, store_eliminate) {
+    vector <Candidate> candidates;
+    candidates.push_back(Candidate("John Doe", 1));
+    candidates.push_back(Candidate("Jane Smith", 2));
+    candidates.push_back(Candidate("Sirchan Sirchan", 3));
+    BallotStore ballots(3);
+    ballots.add(voting_read("1 2 3", 3));
+    ballots.add(voting_read("2 1 3", 3));
+    ballots.add(voting_read("2 1 3", 3));
+    ballots.add(voting_read("3 1 2", 3));
+    candidates.at(0).set_count(1);
+    candidates.at(1).set_count(2);
+    candidates.at(2).set_count(1);
+    eliminate_losers(candidates, ballots);
+    ASSERT_EQ( 1, candidates.size());
+    ASSERT_EQ( 4, candidates.at(0).get_count());
+    ASSERT_EQ( 2, ballots.get_preference(0));
+    ASSERT_EQ( 2, ballots.get_preference(3));
+}
+
 // -----
 // print
 // -----
@@ -219,6 +316,99 @@ TEST(VotingFixture, index_5) {
     ASSERT_EQ( 0,index);
 }
 
+// -----
+// buckets
+// -----
+
+TEST(VotingFixture, buckets_1) {
+    vector <Candidate> candidates;
+    vector <Ballot> ballots;
+    Candidate c("Kaivan Shah", 1);
+    candidates.push_back(c);
+    Candidate d("Lyee Chong", 3);
+    candidates.push_back(d);
+    ballots.push_back(Ballot(voting_read("3 1 2", 3)));
+    ballots.push_back(Ballot(voting_read("2 3 1", 3)));
+    ballots.push_back(Ballot(voting_read("3 2 1", 3)));
+    vector< vector<int> > buckets;
+    vector<int> moving;
+    fill_buckets(candidates, ballots, buckets, moving);
+    ASSERT_EQ( 4, buckets.size());
+    ASSERT_EQ( 0, buckets.at(1).size());
+    ASSERT_EQ( 2, buckets.at(3).size());
+    ASSERT_EQ( 1, moving.size());
+    ASSERT_EQ( 1, moving.at(0));
+}
+
+TEST(VotingFixture, standing_1) {
+    vector <Candidate> candidates;
+    Candidate c("Kaivan Shah", 2);
+    candidates.push_back(c);
+    Candidate d("Lyee Chong", 1);
+    candidates.push_back(d);
+    vector<int> standing = index_standing(candidates, 4);
+    ASSERT_EQ( -1, standing.at(0));
+    ASSERT_EQ( 1, standing.at(1));
+    ASSERT_EQ( 0, standing.at(2));
+    ASSERT_EQ( -1, standing.at(3));
+}
+
+// -----
+// eliminate losers
+// -----
+
+TEST(VotingFixture, eliminate_1) {
+    vector <Candidate> candidates;
+    vector <Ballot> ballots;
+    candidates.push_back(Candidate("John Doe", 1));
+    candidates.push_back(Candidate("Jane Smith", 2));
+    candidates.push_back(Candidate("Sirchan Sirchan", 3));
+    ballots.push_back(Ballot(voting_read("1 2 3", 3)));
+    ballots.push_back(Ballot(voting_read("1 3 2", 3)));
+    ballots.push_back(Ballot(voting_read("2 1 3", 3)));
+    ballots.push_back(Ballot(voting_read("2 1 3", 3)));
+    ballots.push_back(Ballot(voting_read("3 2 1", 3)));
+    candidates.at(0).set_count(2);
+    candidates.at(1).set_count(2);
+    candidates.at(2).set_count(1);
+    eliminate_losers(candidates, ballots);
+    ASSERT_EQ( 2, candidates.size());
+    ASSERT_EQ( 2, candidates.at(0).get_count());
+    ASSERT_EQ( 3, candidates.at(1).get_count());
+    ASSERT_EQ( 2, ballots.at(4).get_preference());
+}
+
+TEST(VotingFixture, eliminate_2) {
+    vector <Candidate> candidates;
+    vector <Ballot> ballots;
+    candidates.push_back(Candidate("John Doe", 1));
+    candidates.push_back(Candidate("Jane Smith", 2));
+    candidates.push_back(Candidate("Sirchan Sirchan", 3));
+    candidates.push_back(Candidate("Potato Joe", 4));
+    ballots.push_back(Ballot(voting_read("1 2 3 4", 4)));
+    ballots.push_back(Ballot(voting_read("1 2 3 4", 4)));
+    ballots.push_back(Ballot(voting_read("2 1 3 4", 4)));
+    ballots.push_back(Ballot(voting_read("2 1 3 4", 4)));
+    ballots.push_back(Ballot(voting_read("3 4 1 2", 4)));
+    ballots.push_back(Ballot(voting_read("4 3 2 1", 4)));
+    candidates.at(0).set_count(2);
+    candidates.at(1).set_count(2);
+    candidates.at(2).set_count(1);
+    candidates.at(3).set_count(1);
+    vector< vector<int> > buckets;
+    vector<int> moving;
+    fill_buckets(candidates, ballots, buckets, moving);
+    eliminate_losers(candidates, ballots, buckets, moving);
+    ASSERT_EQ( 2, candidates.size());
+    ASSERT_EQ( 3, candidates.at(0).get_count());
+    ASSERT_EQ( 3, candidates.at(1).get_count());
+    ASSERT_EQ( 3, buckets.at(1).size());
+    ASSERT_EQ( 0, buckets.at(3).size());
+    ASSERT_EQ( 0, moving.size());
+    ASSERT_EQ( 1, ballots.at(4).get_preference());
+    ASSERT_EQ( 2, ballots.at(5).get_preference());
+}
+
 // -----
 // get winners
 // -----
@@ -334,6 +524,607 @@ TEST(VotingFixture, solve_multiple_cases) {
                 "Jane Smith\n"
                 "Sirchan Sirchan\n", w.str());
 }
+
+// ----
+// scan
+// ----
+
+TEST(VotingFixture, scan_case_1) {
+    string s("3\n"
+             "John Doe\n"
+             "Jane Smith\n"
+             "Sirchan Sirchan\n"
+             "1 2 3\n"
+             "3  2\t1\r\n"
+             "3 1 2\n"
+             "\n"
+             "2\n");
+    vector <Candidate> candidates;
+    BallotStore ballots(1);
+    const char* p = voting_scan_case(s.data(), s.data(), s.data() + s.size(), candidates, ballots);
+    ASSERT_EQ( "2\n", string(p));
+    ASSERT_EQ( 3, candidates.size());
+    ASSERT_EQ( "Sirchan Sirchan", candidates.at(2).get_name());
+    ASSERT_EQ( 1, candidates.at(0).get_count());
+    ASSERT_EQ( 0, candidates.at(1).get_count());
+    ASSERT_EQ( 2, candidates.at(2).get_count());
+    ASSERT_EQ( 3, ballots.size());
+    ASSERT_EQ( 3, ballots.get_width());
+    ASSERT_EQ( 2, ballots.next_preference(1));
+}
+
+TEST(VotingFixture, scan_case_short) {
+    string s("3\nA\nB\nC\n1 2 3\n2 1\n");
+    vector <Candidate> candidates;
+    BallotStore ballots(1);
+    ASSERT_THROW(voting_scan_case(s.data(), s.data(), s.data() + s.size(), candidates, ballots), invalid_argument);
+}
+
+TEST(VotingFixture, scan_case_range) {
+    string s("3\nA\nB\nC\n1 2 3\n2 4 1\n");
+    vector <Candidate> candidates;
+    BallotStore ballots(1);
+    ASSERT_THROW(voting_scan_case(s.data(), s.data(), s.data() + s.size(), candidates, ballots), invalid_argument);
+}
+
+TEST(VotingFixture, scan_case_duplicate) {
+    string s("3\nA\nB\nC\n1 2 3\n2 1 2\n");
+    vector <Candidate> candidates;
+    BallotStore ballots(1);
+    voting_scan_case(s.data(), s.data(), s.data() + s.size(), candidates, ballots);
+    ASSERT_EQ( 2, ballots.size());
+    try
+    {
+        VotingOptions options;
+        options.strict = true;
+        voting_scan_case(s.data(), s.data(), s.data() + s.size(), candidates, ballots, options);
+        FAIL();
+    }
+    catch(const invalid_argument& e)
+    {
+        ASSERT_EQ( string("line 6: duplicate ranking in ballot"), e.what());
+    }
+}
+
+TEST(VotingFixture, solve_buffer_multiple_cases) {
+    string s("2\n\n"
+             "3\n"
+             "John Doe\n"
+             "Jane Smith\n"
+             "Sirchan Sirchan\n"
+             "1 2 3\n"
+             "3 2 1\n"
+             "2 1 3\n"
+             "2 3 1\n"
+             "1 3 2\n\n"
+             "4\n"
+             "John Doe\n"
+             "Jane Smith\n"
+             "Sirchan Sirchan\n"
+             "Potato Joe\n"
+             "1 2 4 3\n"
+             "3 4 2 1\n"
+             "2 1 4 3\n"
+             "2 3 1 4\n"
+             "1 3 2 4\n"
+             "3 4 3 2\n");
+    ostringstream w;
+    voting_solve(s.data(), s.data() + s.size(), w);
+    ASSERT_EQ("Jane Smith\n\n"
+                "John Doe\n"
+                "Jane Smith\n"
+                "Sirchan Sirchan\n", w.str());
+}
+
+// --------
+// parallel
+// --------
+
+TEST(VotingFixture, split_case_1) {
+    string s("\n2\nA\n\n1 2\n2 1\n  \n3\n");
+    const char* p = voting_split_case(s.data(), s.data() + s.size());
+    ASSERT_EQ( "3\n", string(p));
+}
+
+TEST(VotingFixture, split_case_2) {
+    string s("3\nA\nB\n");
+    const char* p = voting_split_case(s.data(), s.data() + s.size());
+    ASSERT_EQ( s.data() + s.size(), p);
+}
+
+TEST(VotingFixture, solve_parallel_matches_sequential) {
+    ostringstream input;
+    input << "40\n\n";
+    for(int i = 0; i < 40; ++i)
+    {
+        input << "3\nJohn Doe\nJane Smith\nSirchan Sirchan\n";
+        for(int j = 0; j <= i % 7; ++j)
+        {
+            input << (j + i) % 3 + 1 << " " << (j + i + 1) % 3 + 1 << " " << (j + i + 2) % 3 + 1 << "\n";
+        }
+        if(i != 39)
+        {
+            input << "\n";
+        }
+    }
+    string s = input.str();
+    ostringstream sequential;
+    voting_solve(s.data(), s.data() + s.size(), sequential);
+    ostringstream parallel;
+    VotingOptions options;
+    options.threads = 4;
+    voting_solve_parallel(s.data(), s.data() + s.size(), parallel, options);
+    ASSERT_EQ(sequential.str(), parallel.str());
+}
+
+TEST(VotingFixture, solve_parallel_error) {
+    string s("3\n\n"
+             "2\nA\nB\n1 2\n\n"
+             "2\nA\nB\n2 3\n\n"
+             "2\nA\nB\n2 1\n");
+    ostringstream w;
+    VotingOptions options;
+    options.threads = 3;
+    ASSERT_THROW(voting_solve_parallel(s.data(), s.data() + s.size(), w, options), invalid_argument);
+    ASSERT_EQ("A\n\n", w.str());
+}
+
+// -------
+// sharded
+// -------
+
+TEST(VotingFixture, eval_sharded_1) {
+    vector <Candidate> candidates;
+    candidates.push_back(Candidate("John Doe", 1));
+    candidates.push_back(Candidate("Jane Smith", 2));
+    candidates.push_back(Candidate("Sirchan Sirchan", 3));
+    candidates.push_back(Candidate("Potato Joe", 4));
+    BallotStore ballots(4);
+    const char* lines[] = {"1 2 3 4", "1 2 3 4", "1 2 3 4", "2 3 4 1", "2 3 4 1",
+                           "3 4 2 1", "3 2 4 1", "4 3 2 1"};
+    for(int i = 0; i < 8; ++i)
+    {
+        ballots.add(voting_read(lines[i], 4));
+    }
+    voting_count(candidates, ballots, 3);
+    ASSERT_EQ( 3, candidates.at(0).get_count());
+    ASSERT_EQ( 1, candidates.at(3).get_count());
+    vector<string> candidate_names = voting_eval_sharded (candidates, ballots, 3);
+    ASSERT_EQ( 1, candidate_names.size());
+    ASSERT_EQ( "Sirchan Sirchan", candidate_names.at(0));
+}
+
+TEST(VotingFixture, eval_sharded_matches_serial) {
+    for(int n = 2; n <= 7; ++n)
+    {
+        vector <Candidate> candidates;
+        for(int c = 1; c <= n; ++c)
+        {
+            candidates.push_back(Candidate(string(1, 'A' + c - 1), c));
+        }
+        BallotStore ballots(n);
+        vector<int> votes(n);
+        for(int b = 0; b < 40 * n + 3; ++b)
+        {
+            for(int c = 0; c < n; ++c)
+            {
+                votes.at(c) = (b * 7 + c * (b % 5 + 1)) % n + 1;
+            }
+            for(int c = 1; c < n; ++c)
+            {
+                //keep the ranking a permutation
+                for(int d = 0; d < c; ++d)
+                {
+                    if(votes.at(d) == votes.at(c))
+                    {
+                        votes.at(c) = votes.at(c) % n + 1;
+                        d = -1;
+                    }
+                }
+            }
+            ballots.add(votes);
+        }
+        voting_count(candidates, ballots, 1);
+        vector<string> expected = voting_eval(candidates, ballots);
+        for(int shards = 2; shards <= 5; ++shards)
+        {
+            ballots.rewind();
+            ASSERT_EQ(expected, voting_eval_sharded(candidates, ballots, shards));
+        }
+    }
+}
+
+TEST(VotingFixture, eval_speedup) {
+    vector <Candidate> candidates;
+    candidates.push_back(Candidate("John Doe", 1));
+    candidates.push_back(Candidate("Jane Smith", 2));
+    BallotStore ballots(2);
+    ballots.add(voting_read("1 2", 2));
+    ballots.add(voting_read("2 1", 2));
+    ASSERT_LT( 0, voting_eval_speedup(candidates, ballots, 2));
+}
+
+// ---------
+// aggregate
+// ---------
+
+TEST(VotingFixture, merge_1) {
+    BallotStore ballots(3);
+    ballots.merge(voting_read("1 2 3", 3));
+    ballots.merge(voting_read("2 1 3", 3));
+    ballots.merge(voting_read("1 2 3", 3));
+    ballots.merge(voting_read("1 2 3", 3));
+    ASSERT_EQ( 2, ballots.size());
+    ASSERT_EQ( 4, ballots.get_total());
+    ASSERT_EQ( 3, ballots.get_weight(0));
+    ASSERT_EQ( 1, ballots.get_weight(1));
+    ASSERT_EQ( 2, ballots.compression());
+}
+
+TEST(VotingFixture, merge_after_add) {
+    BallotStore ballots(2);
+    ballots.add(voting_read("1 2", 2));
+    ballots.add(voting_read("2 1", 2));
+    ASSERT_EQ( 1, ballots.get_weight(1));
+    for(int i = 0; i < 100; ++i)
+    {
+        ballots.merge(voting_read(i % 3 == 0 ? "2 1" : "1 2", 2));
+    }
+    ASSERT_EQ( 2, ballots.size());
+    ASSERT_EQ( 102, ballots.get_total());
+    ASSERT_EQ( 67, ballots.get_weight(0));
+    ASSERT_EQ( 35, ballots.get_weight(1));
+}
+
+TEST(VotingFixture, merge_after_many_adds) {
+    BallotStore ballots(3);
+    const char* lines[] = {"1 2 3", "1 3 2", "2 1 3", "2 3 1", "3 1 2", "3 2 1"};
+    for(int i = 0; i < 18; ++i)
+    {
+        ballots.add(voting_read(lines[i % 6], 3));
+    }
+    ballots.merge(voting_read("2 3 1", 3));
+    ASSERT_EQ( 18, ballots.size());
+    ASSERT_EQ( 2, ballots.get_weight(3));
+    for(int i = 0; i < 40; ++i)
+    {
+        ballots.add(voting_read(lines[i % 6], 3));
+    }
+    ballots.merge(voting_read("3 2 1", 3));
+    ASSERT_EQ( 58, ballots.size());
+    ASSERT_EQ( 60, ballots.get_total());
+    ASSERT_EQ( 2, ballots.get_weight(5));
+}
+
+TEST(VotingFixture, eval_weighted) {
+    vector <Candidate> candidates;
+    candidates.push_back(Candidate("John Doe", 1));
+    candidates.push_back(Candidate("Jane Smith", 2));
+    candidates.push_back(Candidate("Sirchan Sirchan", 3));
+    candidates.push_back(Candidate("Potato Joe", 4));
+    BallotStore raw(4);
+    BallotStore merged(4);
+    const char* lines[] = {"1 2 3 4", "1 2 3 4", "1 2 3 4", "2 3 4 1", "2 3 4 1",
+                           "3 4 2 1", "3 2 4 1", "4 3 2 1"};
+    for(int i = 0; i < 8; ++i)
+    {
+        raw.add(voting_read(lines[i], 4));
+        merged.merge(voting_read(lines[i], 4));
+    }
+    ASSERT_EQ( 5, merged.size());
+    voting_count(candidates, merged, 1);
+    ASSERT_EQ( 3, candidates.at(0).get_count());
+    ASSERT_EQ( voting_eval(candidates, raw), voting_eval(candidates, merged));
+    merged.rewind();
+    ASSERT_EQ( "Sirchan Sirchan", voting_eval_sharded(candidates, merged, 2).at(0));
+}
+
+TEST(VotingFixture, solve_aggregate) {
+    string s("1\n\n"
+             "3\n"
+             "John Doe\n"
+             "Jane Smith\n"
+             "Sirchan Sirchan\n"
+             "1 2 3\n"
+             "3 2 1\n"
+             "2 1 3\n"
+             "1 2 3\n"
+             "1 2 3\n"
+             "3 2 1\n");
+    ostringstream w;
+    ostringstream report;
+    VotingOptions options;
+    options.aggregate = true;
+    options.report = &report;
+    voting_solve(s.data(), s.data() + s.size(), w, options);
+    ASSERT_EQ("John Doe\n", w.str());
+    ASSERT_EQ(0, report.str().find("case 1: 6 ballots, 3 rankings, compression 2,"));
+}
+
+// ------
+// binary
+// ------
+
+TEST(VotingFixture, binary_round_trip) {
+    string s("2\n\n"
+             "3\n"
+             "John Doe\n"
+             "Jane Smith\n"
+             "Sirchan Sirchan\n"
+             "1 2 3\n"
+             "3 2 1\n"
+             "2 1 3\n"
+             "2 3 1\n"
+             "1 3 2\n\n"
+             "2\n"
+             "John Doe\n"
+             "Potato Joe\n"
+             "2 1");
+    ostringstream binary;
+    voting_encode(s.data(), s.data() + s.size(), binary);
+    string b = binary.str();
+    ASSERT_TRUE(voting_is_binary(b.data(), b.data() + b.size()));
+    ASSERT_FALSE(voting_is_binary(s.data(), s.data() + s.size()));
+    ASSERT_EQ( 0, b.size() % 8);
+    ostringstream text;
+    voting_decode(b.data(), b.data() + b.size(), text);
+    ASSERT_EQ(s, text.str());
+    ostringstream w;
+    voting_solve_binary(b.data(), b.data() + b.size(), w);
+    ASSERT_EQ("Jane Smith\n\nPotato Joe\n", w.str());
+}
+
+TEST(VotingFixture, binary_packed) {
+    // "1 2 3" and "3 1 2", two bits per rank
+    unsigned char packed[] = {0xf9, 0x09, 0x00};
+    PackedBallots ballots(packed, 3, 2, 2);
+    ASSERT_EQ( 1, ballots.get_preference(0));
+    ASSERT_EQ( 2, ballots.next_preference(0));
+    ASSERT_EQ( 3, ballots.get_preference(1));
+    ASSERT_EQ( 1, ballots.next_preference(1));
+    ASSERT_EQ( 2, ballots.next_preference(1));
+    ASSERT_THROW(ballots.next_preference(1), out_of_range);
+    ballots.rewind();
+    ASSERT_EQ( 1, ballots.get_preference(0));
+}
+
+TEST(VotingFixture, binary_truncated) {
+    string s("1\n\n2\nA\nB\n1 2\n2 1\n1 2");
+    ostringstream binary;
+    voting_encode(s.data(), s.data() + s.size(), binary);
+    string b = binary.str();
+    ostringstream w;
+    ASSERT_THROW(voting_solve_binary(b.data(), b.data() + b.size() - 8, w), invalid_argument);
+    ASSERT_THROW(voting_decode(s.data(), s.data() + s.size(), w), invalid_argument);
+}
+
+TEST(VotingFixture, binary_counts_from_ranks) {
+    string s("1\n\n3\nA\nB\nC\n1 2 3\n1 2 3\n2 1 3\n3 2 1\n3 1 2");
+    ostringstream binary;
+    voting_encode(s.data(), s.data() + s.size(), binary);
+    string b = binary.str();
+    // 16 byte file header, 14 byte case header, 9 bytes of names, 30 bits of ranks, 1 spare byte
+    ASSERT_EQ( 48, b.size());
+    // the first preferences lie in the ranks, so there are no counts to corrupt
+    ostringstream w;
+    voting_solve_binary(b.data(), b.data() + b.size(), w);
+    ASSERT_EQ("A\n", w.str());
+    // the first rank of the first ballot, low bits of the byte after the names
+    b[16 + 14 + 9] = b[16 + 14 + 9] & 0xfc;
+    ASSERT_THROW(voting_solve_binary(b.data(), b.data() + b.size(), w), invalid_argument);
+    ASSERT_THROW(voting_decode(b.data(), b.data() + b.size(), w), invalid_argument);
+}
+
+// ------------
+// voting_generate
+// ------------
+
+TEST(VotingFixture, generate_seeded) {
+    ostringstream w1;
+    ostringstream w2;
+    voting_generate(w1, 2, 6, 50, "clustered", 7);
+    voting_generate(w2, 2, 6, 50, "clustered", 7);
+    ASSERT_EQ(w1.str(), w2.str());
+    BallotStore ballots(6);
+    voting_generate(ballots, 50, "uniform", 7);
+    ASSERT_EQ(ballots.size(), 50);
+    for(int r = 0, seen = 0; r < 6; ++r)
+    {
+        seen |= 1 << ballots.get_rank(49, r);
+        if(r == 5)
+        {
+            ASSERT_EQ(seen, 0x7e);
+        }
+    }
+    ASSERT_THROW(voting_generate(ballots, 1, "normal", 7), invalid_argument);
+}
+
+TEST(VotingFixture, generate_adversarial) {
+    ostringstream r;
+    voting_generate(r, 1, 5, 1000, "adversarial", 1);
+    string s = r.str();
+    ostringstream w;
+    voting_solve(s.data(), s.data() + s.size(), w);
+    ASSERT_EQ(w.str(), "Candidate 4\nCandidate 5\n");
+    vector<Candidate> candidates;
+    for(int i = 1; i <= 20; ++i)
+    {
+        candidates.push_back(Candidate("Candidate " + to_string(i), i));
+    }
+    BallotStore ballots(20);
+    voting_generate(ballots, 1000, "adversarial", 1);
+    voting_count(candidates, ballots, 1);
+    vector<VotingRound> rounds;
+    ASSERT_EQ( 2, voting_eval(candidates, ballots, rounds).size());
+    ASSERT_EQ( 19, rounds.size());
+}
+
+TEST(VotingFixture, generate_tied) {
+    ostringstream r;
+    voting_generate(r, 1, 5, 1000, "tied", 1);
+    string s = r.str();
+    ostringstream w;
+    voting_solve(s.data(), s.data() + s.size(), w);
+    ASSERT_EQ(w.str(), "Candidate 1\nCandidate 2\nCandidate 3\nCandidate 4\nCandidate 5\n");
+    vector<Candidate> candidates;
+    for(int i = 1; i <= 20; ++i)
+    {
+        candidates.push_back(Candidate("Candidate " + to_string(i), i));
+    }
+    BallotStore ballots(20);
+    voting_generate(ballots, 1007, "tied", 1);
+    voting_count(candidates, ballots, 1);
+    vector<VotingRound> rounds;
+    voting_eval(candidates, ballots, rounds);
+    ASSERT_EQ( 13, rounds.at(0).eliminated.size());
+}
+
+// ------------
+// voting_trace
+// ------------
+
+TEST(VotingFixture, eval_rounds) {
+    vector <Candidate> candidates;
+    candidates.push_back(Candidate("A", 1));
+    candidates.push_back(Candidate("B", 2));
+    candidates.push_back(Candidate("C", 3));
+    candidates.push_back(Candidate("D", 4));
+    BallotStore ballots(4);
+    const char* lines[] = {"1 2 3 4", "1 3 2 4", "2 1 3 4", "2 3 1 4", "3 4 2 1"};
+    for(int i = 0; i < 5; ++i)
+    {
+        ballots.add(voting_read(lines[i], 4));
+    }
+    voting_count(candidates, ballots, 1);
+    vector<VotingRound> rounds(1);
+    vector<string> candidate_names = voting_eval (candidates, ballots, rounds);
+    ASSERT_EQ( 1, candidate_names.size());
+    ASSERT_EQ( "B", candidate_names.at(0));
+    ASSERT_EQ( 3, rounds.size());
+    ASSERT_EQ( 1, rounds.at(0).round);
+    ASSERT_EQ( 4, rounds.at(0).tallies.size());
+    ASSERT_EQ( vector<string>(1, "D"), rounds.at(0).eliminated);
+    ASSERT_EQ( 0, rounds.at(0).transferred);
+    ASSERT_EQ( vector<string>(1, "C"), rounds.at(1).eliminated);
+    ASSERT_EQ( 1, rounds.at(1).transferred);
+    ASSERT_EQ( 1, rounds.at(1).skipped);
+    ASSERT_EQ( 3, rounds.at(2).tallies.at(1).get_count());
+    ASSERT_TRUE(rounds.at(2).eliminated.empty());
+
+    ballots.rewind();
+    vector<VotingRound> sharded;
+    ASSERT_EQ( candidate_names, voting_eval_sharded(candidates, ballots, 3, sharded));
+    ASSERT_EQ( 3, sharded.size());
+    ASSERT_EQ( 1, sharded.at(1).transferred);
+    ASSERT_EQ( 1, sharded.at(1).skipped);
+}
+
+TEST(VotingFixture, trace_json) {
+    VotingRound round;
+    round.round = 2;
+    round.tallies.push_back(Candidate("Jane \"J\" Doe\\", 1));
+    round.tallies.at(0).set_count(7);
+    round.eliminated.push_back("Tab\tName");
+    round.transferred = 3;
+    ostringstream w;
+    voting_trace(w, 4, vector<VotingRound>(1, round));
+    ASSERT_EQ("{\"case\":4,\"round\":2,\"tallies\":[{\"candidate\":\"Jane \\\"J\\\" Doe\\\\\",\"votes\":7}],"
+              "\"eliminated\":[\"Tab\\u0009Name\"],\"transferred\":3,\"skipped\":0,\"count_seconds\":0,\"transfer_seconds\":0}\n", w.str());
+}
+
+TEST(VotingFixture, solve_trace) {
+    string s("2\n\n3\nA\nB\nC\n1 2 3\n2 1 3\n3 1 2\n\n1\nA\n1");
+    ostringstream trace;
+    VotingOptions options;
+    options.threads = 2;
+    options.trace = &trace;
+    ostringstream w;
+    voting_solve_parallel(s.data(), s.data() + s.size(), w, options);
+    ASSERT_EQ("A\nB\nC\n\nA\n", w.str());
+    string lines = trace.str();
+    ASSERT_EQ( 2, count(lines.begin(), lines.end(), '\n'));
+    ASSERT_EQ( 0, lines.find("{\"case\":1,\"round\":1,"));
+    ASSERT_NE( string::npos, lines.find("{\"case\":2,\"round\":1,"));
+}
+
+// ------------
+// OnlineElection
+// ------------
+
+TEST(VotingFixture, online_1) {
+    vector<string> names;
+    names.push_back("John Doe");
+    names.push_back("Jane Smith");
+    names.push_back("Sirchan Sirchan");
+    OnlineElection election(names);
+    ASSERT_EQ( names, election.current_result());
+    vector< vector<int> > batch;
+    batch.push_back(voting_read("1 2 3", 3));
+    batch.push_back(voting_read("2 1 3", 3));
+    batch.push_back(voting_read("2 3 1", 3));
+    batch.push_back(voting_read("1 2 3", 3));
+    batch.push_back(voting_read("3 1 2", 3));
+    election.add_ballots(batch);
+    ASSERT_EQ( vector<string>(1, "John Doe"), election.current_result());
+    int recounts = election.get_recounts();
+    election.add_ballots(vector< vector<int> >(1, voting_read("1 3 2", 3)));
+    ASSERT_EQ( vector<string>(1, "John Doe"), election.current_result());
+    ASSERT_EQ( recounts, election.get_recounts());
+    ASSERT_EQ( 6, election.get_total());
+    election.add_ballots(vector< vector<int> >(2, voting_read("3 2 1", 3)));
+    vector<string> tied;
+    tied.push_back("John Doe");
+    tied.push_back("Sirchan Sirchan");
+    ASSERT_EQ( tied, election.current_result());
+    ASSERT_EQ( recounts + 1, election.get_recounts());
+}
+
+TEST(VotingFixture, online_2) {
+    OnlineElection election(vector<string>(2, "A"));
+    vector< vector<int> > batch;
+    batch.push_back(voting_read("1 2", 2));
+    batch.push_back(voting_read("2 2", 2));
+    ASSERT_THROW(election.add_ballots(batch), invalid_argument);
+    ASSERT_THROW(election.add_ballots(vector< vector<int> >(1, voting_read("1 2 3", 3))), invalid_argument);
+    ASSERT_EQ( 0, election.get_total());
+    ASSERT_THROW(OnlineElection(vector<string>()), out_of_range);
+}
+
+TEST(VotingFixture, online_3) {
+    const char* distributions[] = {"uniform", "clustered", "adversarial", "tied"};
+    for(int n = 1; n <= 8; ++n)
+    {
+        vector<string> names;
+        vector<Candidate> candidates;
+        for(int i = 1; i <= n; ++i)
+        {
+            names.push_back("Candidate " + to_string(i));
+            candidates.push_back(Candidate(names.back(), i));
+        }
+        OnlineElection election(names);
+        BallotStore all(n);
+        for(int b = 0; b < 6; ++b)
+        {
+            BallotStore generated(n);
+            voting_generate(generated, 7 * b + n, distributions[(n + b) % 4], n * 10 + b);
+            vector< vector<int> > batch(generated.size());
+            for(int i = 0; i < generated.size(); ++i)
+            {
+                for(int r = 0; r < n; ++r)
+                {
+                    batch.at(i).push_back(generated.get_rank(i, r));
+                }
+                all.add(batch.at(i));
+            }
+            election.add_ballots(batch);
+            vector<Candidate> counted = candidates;
+            all.rewind();
+            voting_count(counted, all, 1);
+            ASSERT_EQ( voting_eval(counted, all), election.current_result());
+        }
+    }
+}
+
 /*
 g++-4.8 -pedantic -std=c++11 -Wall -fprofile-arcs -ftest-coverage Voting.c++ TestVoting.c++ -o TestVoting -lgtest -lgtest_main -pthread
 Voting.c++: In function ‘std::vector<std::basic_string<char> > voting_eval(std::vector<Candidate>, std::vector<Ballot>)’:
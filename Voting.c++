@@ -7,11 +7,25 @@
 // includes
 // --------
  
-#include <cassert>  // assert
-#include <iostream> // endl, istream, ostream
-#include <sstream>  // istringstream
-#include <string>   // getline, string
-#include <utility>  // make_pair, pair
+#include <cassert>            // assert
+#include <cerrno>             // errno
+#include <chrono>             // steady_clock
+#include <condition_variable> // condition_variable
+#include <cstring>            // memchr, strerror
+#include <deque>              // deque
+#include <exception>          // current_exception, exception_ptr, rethrow_exception
+#include <iostream>           // endl, istream, ostream
+#include <mutex>              // mutex, unique_lock
+#include <sstream>            // istringstream, ostringstream
+#include <stdexcept>          // invalid_argument, logic_error, runtime_error
+#include <string>             // getline, string
+#include <thread>             // thread
+#include <utility>            // make_pair, pair
+
+#include <fcntl.h>    // open
+#include <sys/mman.h> // madvise, mmap, munmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // close, read
 
 #include "Voting.h"
 
@@ -39,35 +53,190 @@ vector<int> voting_read (const string& s, int size) {
     return ballots;}
 
 // ------------
-// voting_eval
+// BallotStore
 // ------------
 
+static size_t hash_ranking (const unsigned char* pref, int width) {
+    size_t h = 2166136261u;
+    for(int i = 0; i < width; ++i)
+    {
+        h = (h ^ pref[i]) * 16777619u;
+    }
+    return h;}
+
 /**
- * read a vector of Candidate and a vector of Ballot
- * @param candidates a vector of Candidate
- * @param ballots a vector of Ballots
- * @return a vector of string
+ * rebuild the ranking index with the given number of slots, a power of two
  */
-vector<string> voting_eval (vector <Candidate> candidates, vector <Ballot> ballots) 
+void BallotStore::rehash (int slots)
 {
-    vector <string> candidateNames;
-    vector<Candidate> winningCandidates;
-    while(candidateNames.size() == 0)
+    table.assign(slots, -1);
+    for(int b = 0; b < size(); ++b)
     {
-        winningCandidates = get_winners(candidates, ballots.size());
-        if(winningCandidates.size() > 0)
+        size_t i = hash_ranking(&rankings[(size_t)b * width], width) & (slots - 1);
+        while(table[i] != -1)
         {
-            for(int i = 0; i < winningCandidates.size(); i++)
-            {
-                candidateNames.push_back(winningCandidates.at(i).get_name());
-            }
+            i = (i + 1) & (slots - 1);
+        }
+        table[i] = b;
+    }
+}
+
+/**
+ * add a ballot, or add 1 to the weight of the stored ballot with the same ranking
+ * @param pref a ranking of width candidates
+ */
+void BallotStore::merge (const unsigned char* pref)
+{
+    if(weights.size() != cursor.size())
+    {
+        weights.assign(cursor.size(), 1);
+    }
+    if((size() + 1) * 2 > (int)table.size())
+    {
+        //ballots from add() are not in the table yet, so size it for all of them
+        int slots = 16;
+        while(slots < (size() + 1) * 2)
+        {
+            slots *= 2;
+        }
+        rehash(slots);
+    }
+    size_t mask = table.size() - 1;
+    size_t i = hash_ranking(pref, width) & mask;
+    while(table[i] != -1)
+    {
+        if(memcmp(&rankings[(size_t)table[i] * width], pref, width) == 0)
+        {
+            ++weights[table[i]];
+            ++total;
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+    table[i] = size();
+    rankings.insert(rankings.end(), pref, pref + width);
+    cursor.push_back(0);
+    weights.push_back(1);
+    ++total;
+}
+
+/**
+ * add a ballot, or add 1 to the weight of the stored ballot with the same ranking
+ * @param pref a vector of ints
+ */
+void BallotStore::merge (const vector<int>& pref)
+{
+    unsigned char ranking[255];
+    for(int i = 0; i < width; ++i)
+    {
+        int p = i < (int)pref.size() ? pref.at(i) : 0;
+        if(p < 0 || p > 255)
+        {
+            throw out_of_range("BallotStore::merge");
+        }
+        ranking[i] = p;
+    }
+    merge(ranking);
+}
+
+// ------------
+// ballot access
+// ------------
+
+// The elimination engine below is written once, for both vector<Ballot>
+// and BallotStore; these overloads are the only place the two differ.
+// A Ballot always weighs 1; a stored ballot may stand for many identical ones.
+
+static int preference_of (vector<Ballot>& ballots, int b) {
+    return ballots.at(b).get_preference();}
+
+static int advance (vector<Ballot>& ballots, int b) {
+    return ballots.at(b).next_preference();}
+
+static int weight_of (vector<Ballot>& ballots, int b) {
+    return 1;}
+
+static int total_of (vector<Ballot>& ballots) {
+    return ballots.size();}
+
+static int preference_of (const BallotStore& ballots, int b) {
+    return ballots.get_preference(b);}
+
+static int advance (BallotStore& ballots, int b) {
+    return ballots.next_preference(b);}
+
+static int weight_of (const BallotStore& ballots, int b) {
+    return ballots.get_weight(b);}
+
+static int total_of (const BallotStore& ballots) {
+    return ballots.get_total();}
+
+static int preference_of (const PackedBallots& ballots, int b) {
+    return ballots.get_preference(b);}
+
+static int advance (PackedBallots& ballots, int b) {
+    return ballots.next_preference(b);}
+
+static int weight_of (const PackedBallots& ballots, int b) {
+    return 1;}
+
+static int total_of (const PackedBallots& ballots) {
+    return ballots.get_total();}
+
+// ------------
+// fill_buckets
+// ------------
+
+template <typename Ballots>
+static void fill_buckets_of(const vector<Candidate>& candidates, Ballots& ballots, vector< vector<int> >& buckets, vector<int>& moving)
+{
+    int size = 1;
+    for(int i = 0 ; i < (int)candidates.size(); ++i)
+    {
+        if(candidates.at(i).get_position() >= size)
+        {
+            size = candidates.at(i).get_position() + 1;
+        }
+    }
+    vector<int> standing = index_standing(candidates, size);
+    buckets.assign(size, vector<int>());
+    moving.clear();
+    for(int i = 0 ; i < (int)ballots.size(); ++i)
+    {
+        int preference = preference_of(ballots, i);
+        if(preference > 0 && preference < size && standing.at(preference) != -1)
+        {
+            buckets.at(preference).push_back(i);
         }
         else
         {
-            eliminate_losers(candidates, ballots);
+            moving.push_back(i);
         }
     }
-    return candidateNames;
+}
+
+/**
+ * sort each ballot under the candidate its current preference counts for
+ * @param candidates a vector of the standing Candidate
+ * @param ballots a vector of Ballots
+ * @param buckets ballot indices indexed by candidate position
+ * @param moving ballot indices whose preference is not a standing candidate
+ */
+void fill_buckets(const vector<Candidate>& candidates, vector<Ballot>& ballots, vector< vector<int> >& buckets, vector<int>& moving)
+{
+    fill_buckets_of(candidates, ballots, buckets, moving);
+}
+
+/**
+ * sort each stored ballot under the candidate its current preference counts for
+ * @param candidates a vector of the standing Candidate
+ * @param ballots a BallotStore
+ * @param buckets ballot indices indexed by candidate position
+ * @param moving ballot indices whose preference is not a standing candidate
+ */
+void fill_buckets(const vector<Candidate>& candidates, const BallotStore& ballots, vector< vector<int> >& buckets, vector<int>& moving)
+{
+    fill_buckets_of(candidates, ballots, buckets, moving);
 }
 
 // ------------
@@ -75,15 +244,16 @@ vector<string> voting_eval (vector <Candidate> candidates, vector <Ballot> ballo
 // ------------
 
 /**
- * read a vector of Candidate and a vector of Ballot
- * @param candidates a vector of Candidate
- * @param ballots a vector of Ballots
+ * erase every candidate tied for the fewest votes
+ * @param candidates a vector of the standing Candidate
+ * @param ballotCount an integer, the most votes a loser can have
+ * @return the positions of the erased candidates
  */
-void eliminate_losers(vector<Candidate>& candidates, vector<Ballot>& ballots)
+static vector<int> remove_losers(vector<Candidate>& candidates, int ballotCount)
 {
-    int loserCount = ballots.size();
+    int loserCount = ballotCount;
     vector<int> loserPositions; 
-    for(int i = 0 ; i < candidates.size(); ++i)
+    for(int i = 0 ; i < (int)candidates.size(); ++i)
     {
         if(candidates.at(i).get_count() < loserCount)
         {
@@ -96,172 +266,2021 @@ void eliminate_losers(vector<Candidate>& candidates, vector<Ballot>& ballots)
         }
     }
     //erase all the candidates that have lost
+    vector<int> losers;
     for(int i = loserPositions.size()-1; i >=0; --i)
     {
+        losers.push_back(candidates.at(loserPositions.at(i)).get_position());
         candidates.erase(candidates.begin()+loserPositions.at(i));
     }
+    return losers;
+}
 
-    for(int i = 0 ; i < ballots.size(); ++i)
+/**
+ * move the ballots held by the losers to their next standing candidate
+ * @param ballots the ballots the buckets index into
+ * @param losers the positions of the eliminated candidates
+ * @param standing candidate indices by position, from index_standing
+ * @param buckets ballot indices indexed by the position they are counted for
+ * @param moving ballot indices not counted for any standing candidate
+ * @param gained votes indexed by position, added to for every transfer
+ */
+template <typename Ballots, bool Traced = false>
+static void transfer_of(Ballots& ballots, const vector<int>& losers, const vector<int>& standing, vector< vector<int> >& buckets, vector<int>& moving, vector<int>& gained, VotingRound* round = 0)
+{
+    for(int i = 0 ; i < (int)losers.size(); ++i)
     {
-        //while it's looking at a candidate that has already lost, find the next candidate
-        while(find_candidate_index(candidates, ballots.at(i).get_preference()) == -1)
+        vector<int>& held = buckets.at(losers.at(i));
+        moving.insert(moving.end(), held.begin(), held.end());
+        vector<int>().swap(held);
+    }
+    long long transferred = 0;
+    long long skipped = 0;
+    for(int i = 0 ; i < (int)moving.size(); ++i)
+    {
+        //skip every candidate that has already lost
+        int preference = advance(ballots, moving.at(i));
+        while(preference <= 0 || preference >= (int)standing.size() || standing.at(preference) == -1)
         {
-            ballots.at(i).next_preference();
-            if(find_candidate_index(candidates, ballots.at(i).get_preference()) != -1)
+            preference = advance(ballots, moving.at(i));
+            if(Traced)
             {
-                candidates.at(find_candidate_index(candidates, ballots.at(i).get_preference())).increase();
+                ++skipped;
             }
         }
+        gained.at(preference) += weight_of(ballots, moving.at(i));
+        if(Traced)
+        {
+            transferred += weight_of(ballots, moving.at(i));
+        }
+        buckets.at(preference).push_back(moving.at(i));
+    }
+    moving.clear();
+    if(Traced)
+    {
+        round->transferred += transferred;
+        round->skipped += skipped;
     }
-
 }
 
-// ------------
-// find_candidate_index
-// ------------
-
 /**
- * read a vector of Candidate and an integer
- * @param candidates a vector of Candidate
- * @param preference an integer
- * @return a vector of Candidate
+ * credit the standing candidates with the votes transferred to them
  */
-int find_candidate_index(vector<Candidate> candidates, int preference)
+static void add_gains(vector<Candidate>& candidates, const vector<int>& standing, const vector<int>& gained)
 {
-    for(int i = 0 ; i < candidates.size(); ++i)
+    for(int p = 0 ; p < (int)gained.size(); ++p)
     {
-        if(candidates.at(i).get_position() == preference)
+        if(gained.at(p) != 0)
         {
-            return i;
+            Candidate& c = candidates.at(standing.at(p));
+            c.set_count(c.get_count() + gained.at(p));
         }
     }
-    return -1;
-} 
+}
+
+template <typename Ballots, bool Traced = false>
+static void eliminate_losers_of(vector<Candidate>& candidates, Ballots& ballots, vector< vector<int> >& buckets, vector<int>& moving, VotingRound* round = 0)
+{
+    vector<int> losers = remove_losers(candidates, total_of(ballots));
+    vector<int> standing = index_standing(candidates, buckets.size());
+    vector<int> gained(buckets.size(), 0);
+    transfer_of<Ballots, Traced>(ballots, losers, standing, buckets, moving, gained, round);
+    add_gains(candidates, standing, gained);
+}
+
+/**
+ * read a vector of Candidate and a vector of Ballot
+ * @param candidates a vector of Candidate
+ * @param ballots a vector of Ballots
+ */
+void eliminate_losers(vector<Candidate>& candidates, vector<Ballot>& ballots)
+{
+    vector< vector<int> > buckets;
+    vector<int> moving;
+    fill_buckets_of(candidates, ballots, buckets, moving);
+    eliminate_losers_of(candidates, ballots, buckets, moving);
+}
+
+/**
+ * eliminate the losers and transfer only the ballots counted for them
+ * @param candidates a vector of the standing Candidate
+ * @param ballots a vector of Ballots
+ * @param buckets ballot indices indexed by the position they are counted for
+ * @param moving ballot indices not counted for any standing candidate
+ */
+void eliminate_losers(vector<Candidate>& candidates, vector<Ballot>& ballots, vector< vector<int> >& buckets, vector<int>& moving)
+{
+    eliminate_losers_of(candidates, ballots, buckets, moving);
+}
+
+/**
+ * read a vector of Candidate and a BallotStore
+ * @param candidates a vector of Candidate
+ * @param ballots a BallotStore
+ */
+void eliminate_losers(vector<Candidate>& candidates, BallotStore& ballots)
+{
+    vector< vector<int> > buckets;
+    vector<int> moving;
+    fill_buckets_of(candidates, ballots, buckets, moving);
+    eliminate_losers_of(candidates, ballots, buckets, moving);
+}
+
+/**
+ * eliminate the losers and transfer only the ballots counted for them
+ * @param candidates a vector of the standing Candidate
+ * @param ballots a BallotStore
+ * @param buckets ballot indices indexed by the position they are counted for
+ * @param moving ballot indices not counted for any standing candidate
+ */
+void eliminate_losers(vector<Candidate>& candidates, BallotStore& ballots, vector< vector<int> >& buckets, vector<int>& moving)
+{
+    eliminate_losers_of(candidates, ballots, buckets, moving);
+}
 
 // ------------
-// get_winners
+// voting_eval
 // ------------
 
 /**
- * read a vector of Candidate and an integer
- * @param candidates a vector of Candidate
- * @param ballotCount an integer
- * @return a vector of Candidate
+ * start a VotingRound once its count is done
+ * @return when the count finished
  */
-vector<Candidate> get_winners(vector<Candidate> candidates, int ballotCount)
+static chrono::steady_clock::time_point record_count (vector<VotingRound>& rounds, const vector<Candidate>& candidates, chrono::steady_clock::time_point start)
 {
-    int winnersCount = 0;
-    int tiedVotes = -1;
-    vector<Candidate> winner;
-    if(ballotCount % candidates.size() == 0)
-    {
-        tiedVotes = ballotCount/candidates.size();
-    }
-    for(int i = 0; i <candidates.size(); ++i)
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    rounds.push_back(VotingRound());
+    VotingRound& round = rounds.back();
+    round.round = rounds.size();
+    round.tallies = candidates;
+    round.count_seconds = chrono::duration<double>(now - start).count();
+    return now;
+}
+
+/**
+ * finish a VotingRound once its transfers are done, naming who it eliminated
+ * @return when the transfers finished
+ */
+static chrono::steady_clock::time_point record_transfer (VotingRound& round, const vector<Candidate>& candidates, chrono::steady_clock::time_point start)
+{
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    round.transfer_seconds = chrono::duration<double>(now - start).count();
+    for(int i = 0; i < (int)round.tallies.size(); ++i)
     {
-        if(candidates.at(i).get_count() > ballotCount/2)
-        {
-            winner.push_back(candidates.at(i));
-            return winner;
-        }
-        if(candidates.at(i).get_count() == tiedVotes)
+        if(find_candidate_index(candidates, round.tallies.at(i).get_position()) == -1)
         {
-            ++winnersCount;
+            round.eliminated.push_back(round.tallies.at(i).get_name());
         }
     }
-    if(candidates.size() == winnersCount)
-    {
-        return candidates;
-    }
-    return winner;
+    return now;
 }
 
-// -------------
-// voting_print
-// -------------
-
 /**
- * print three ints
- * @param w an ostream
- * @param names a vector of string
- * @param isEOF a Boolean
+ * the elimination loop shared by every ballot type; with Traced false the
+ * rounds pointer is never read and the loop compiles as if it did not exist
  */
-void voting_print (ostream& w, vector<string> names, bool isEOF) {
-    for(int i = 0; i < names.size(); ++i)
+template <typename Ballots, bool Traced = false>
+static vector<string> voting_eval_of (vector<Candidate>& candidates, Ballots& ballots, vector<VotingRound>* rounds = 0)
+{
+    vector <string> candidateNames;
+    vector<Candidate> winningCandidates;
+    vector< vector<int> > buckets;
+    vector<int> moving;
+    chrono::steady_clock::time_point start;
+    if(Traced)
     {
-        
-        if(isEOF)
+        rounds->clear();
+        start = chrono::steady_clock::now();
+    }
+    fill_buckets_of(candidates, ballots, buckets, moving);
+    while(candidateNames.size() == 0)
+    {
+        winningCandidates = get_winners(candidates, total_of(ballots));
+        if(Traced)
         {
-            w << names.at(i) << endl;
+            start = record_count(*rounds, candidates, start);
         }
-        else
+        if(winningCandidates.size() > 0)
         {
-            if(i != names.size()-1)
+            for(int i = 0; i < (int)winningCandidates.size(); i++)
             {
-                w << names.at(i) << endl;
+                candidateNames.push_back(winningCandidates.at(i).get_name());
             }
-            else
+        }
+        else
+        {
+            eliminate_losers_of<Ballots, Traced>(candidates, ballots, buckets, moving, Traced ? &rounds->back() : 0);
+            if(Traced)
             {
-                w << names.at(i) << endl << endl;
+                start = record_transfer(rounds->back(), candidates, start);
             }
         }
     }
+    return candidateNames;
 }
 
-// -------------
-// voting_solve
-// -------------
+/**
+ * read a vector of Candidate and a vector of Ballot
+ * @param candidates a vector of Candidate
+ * @param ballots a vector of Ballots
+ * @return a vector of string
+ */
+vector<string> voting_eval (vector <Candidate> candidates, vector <Ballot> ballots) 
+{
+    return voting_eval_of(candidates, ballots);
+}
 
 /**
- * @param r an istream
- * @param w an ostream
+ * read a vector of Candidate and a BallotStore
+ * @param candidates a vector of Candidate
+ * @param ballots a BallotStore, whose cursors are advanced
+ * @return a vector of string
  */
-void voting_solve (istream& r, ostream& w) {
-    string firstLine;
-    getline(r,firstLine);
-    //cout << "first line1s == " <<endl;
-    //cout << "first line == " << firstLine <<endl;
-    int testCases = stoi(firstLine);
-    getline(r,firstLine); //skip the next blank line
-    int currentCase = 0;
-    while (currentCase < testCases)
-    {
-        vector <Candidate> candidates;
-        vector <Ballot> ballots;
-        string s;
-        int counter = 1;
-        getline(r,s);
-        int cases = stoi (s);
-        while (counter <= cases)
-        {
-            getline(r,s);
-            Candidate c(s, counter);
-            candidates.push_back(c);
-            counter++;
-        }
-        if(!r.eof())
-        {
-            getline(r,s);
-        }
-        while (!r.eof() && s.compare("") != 0)
-        {
-            vector<int> votes;
-            votes = voting_read(s, cases);
-            Ballot b(votes);
-            ballots.push_back(b);
-            candidates.at(votes.at(0)-1).increase(); //incresing the vote count of the candidate
-            getline(r,s);
-        } 
-        if(r.eof())
-        {
-            vector<int> votes;
+vector<string> voting_eval (vector <Candidate> candidates, BallotStore& ballots) 
+{
+    return voting_eval_of(candidates, ballots);
+}
+
+/**
+ * read a vector of Candidate and the PackedBallots of a binary ballot file
+ * @param candidates a vector of Candidate
+ * @param ballots a PackedBallots, whose cursors are advanced
+ * @return a vector of string
+ */
+vector<string> voting_eval (vector <Candidate> candidates, PackedBallots& ballots) 
+{
+    return voting_eval_of(candidates, ballots);
+}
+
+/**
+ * read a vector of Candidate and a BallotStore, recording every round
+ * @param candidates a vector of Candidate
+ * @param ballots a BallotStore, whose cursors are advanced
+ * @param rounds a vector of VotingRound, replaced by one per round
+ * @return a vector of string
+ */
+vector<string> voting_eval (vector <Candidate> candidates, BallotStore& ballots, vector<VotingRound>& rounds) 
+{
+    return voting_eval_of<BallotStore, true>(candidates, ballots, &rounds);
+}
+
+/**
+ * read a vector of Candidate and the PackedBallots of a binary ballot file, recording every round
+ * @param candidates a vector of Candidate
+ * @param ballots a PackedBallots, whose cursors are advanced
+ * @param rounds a vector of VotingRound, replaced by one per round
+ * @return a vector of string
+ */
+vector<string> voting_eval (vector <Candidate> candidates, PackedBallots& ballots, vector<VotingRound>& rounds) 
+{
+    return voting_eval_of<PackedBallots, true>(candidates, ballots, &rounds);
+}
+
+// ------------
+// voting_eval_sharded
+// ------------
+
+//! BallotShard.
+/*!
+	A contiguous slice of a BallotStore, indexed from 0 like a whole store,
+	so the elimination engine can run on it unchanged.
+*/
+struct BallotShard
+{
+	BallotStore* store;
+	int first;
+	int count;
+	int size() const {return count;}
+};
+
+static int preference_of (const BallotShard& shard, int b) {
+    return shard.store->get_preference(shard.first + b);}
+
+static int advance (BallotShard& shard, int b) {
+    return shard.store->next_preference(shard.first + b);}
+
+static int weight_of (const BallotShard& shard, int b) {
+    return shard.store->get_weight(shard.first + b);}
+
+static int shard_count (int shards, int ballots) {
+    if(shards <= 0)
+    {
+        shards = thread::hardware_concurrency();
+    }
+    if(shards > ballots)
+    {
+        shards = ballots;
+    }
+    return shards < 1 ? 1 : shards;}
+
+static vector<BallotShard> make_shards (BallotStore* ballots, int shards) {
+    vector<BallotShard> slices(shards);
+    for(int s = 0; s < shards; ++s)
+    {
+        slices.at(s).store = ballots;
+        slices.at(s).first = (long long)ballots->size() * s / shards;
+        slices.at(s).count = (long long)ballots->size() * (s + 1) / shards - slices.at(s).first;
+    }
+    return slices;}
+
+/**
+ * run work(s) for every shard s, shard 0 on the calling thread
+ * and the rest on threads of their own; the first failure is rethrown
+ */
+template <typename Work>
+static void run_shards (int shards, Work work)
+{
+    vector<exception_ptr> errors(shards);
+    vector<thread> threads;
+    for(int s = 1; s < shards; ++s)
+    {
+        threads.push_back(thread([&errors, &work, s]()
+        {
+            try
+            {
+                work(s);
+            }
+            catch(...)
+            {
+                errors.at(s) = current_exception();
+            }
+        }));
+    }
+    try
+    {
+        work(0);
+    }
+    catch(...)
+    {
+        errors.at(0) = current_exception();
+    }
+    for(int i = 0; i < (int)threads.size(); ++i)
+    {
+        threads.at(i).join();
+    }
+    for(int s = 0; s < shards; ++s)
+    {
+        if(errors.at(s))
+        {
+            rethrow_exception(errors.at(s));
+        }
+    }
+}
+
+template <bool Traced>
+static vector<string> voting_eval_sharded_of (vector<Candidate>& candidates, BallotStore& ballots, int shards, vector<VotingRound>* rounds)
+{
+    shards = shard_count(shards, ballots.size());
+    vector<BallotShard> slices = make_shards(&ballots, shards);
+    vector< vector< vector<int> > > buckets(shards);
+    vector< vector<int> > moving(shards);
+    vector< vector<int> > gained(shards);
+    vector<VotingRound> counted(Traced ? shards : 0);
+    chrono::steady_clock::time_point start;
+    if(Traced)
+    {
+        rounds->clear();
+        start = chrono::steady_clock::now();
+    }
+    run_shards(shards, [&](int s)
+    {
+        fill_buckets_of(candidates, slices.at(s), buckets.at(s), moving.at(s));
+    });
+
+    vector <string> candidateNames;
+    vector<Candidate> winningCandidates;
+    while(candidateNames.size() == 0)
+    {
+        winningCandidates = get_winners(candidates, total_of(ballots));
+        if(Traced)
+        {
+            start = record_count(*rounds, candidates, start);
+        }
+        if(winningCandidates.size() > 0)
+        {
+            for(int i = 0; i < (int)winningCandidates.size(); i++)
+            {
+                candidateNames.push_back(winningCandidates.at(i).get_name());
+            }
+        }
+        else
+        {
+            //pick the losers on the merged tally, transfer per shard, merge again
+            vector<int> losers = remove_losers(candidates, total_of(ballots));
+            vector<int> standing = index_standing(candidates, buckets.at(0).size());
+            run_shards(shards, [&](int s)
+            {
+                gained.at(s).assign(standing.size(), 0);
+                transfer_of<BallotShard, Traced>(slices.at(s), losers, standing, buckets.at(s), moving.at(s), gained.at(s), Traced ? &counted.at(s) : 0);
+            });
+            for(int s = 0; s < shards; ++s)
+            {
+                add_gains(candidates, standing, gained.at(s));
+                if(Traced)
+                {
+                    rounds->back().transferred += counted.at(s).transferred;
+                    rounds->back().skipped += counted.at(s).skipped;
+                    counted.at(s) = VotingRound();
+                }
+            }
+            if(Traced)
+            {
+                start = record_transfer(rounds->back(), candidates, start);
+            }
+        }
+    }
+    return candidateNames;
+}
+
+/**
+ * evaluate one election with its ballots split into shards, tallied by one thread each
+ * @param candidates a vector of Candidate
+ * @param ballots a BallotStore, whose cursors are advanced
+ * @param shards the number of shards, 0 for one per core
+ * @return a vector of string, the same as voting_eval returns
+ */
+vector<string> voting_eval_sharded (vector<Candidate> candidates, BallotStore& ballots, int shards)
+{
+    return voting_eval_sharded_of<false>(candidates, ballots, shards, 0);
+}
+
+/**
+ * evaluate one election with its ballots split into shards, recording every round
+ * @param candidates a vector of Candidate
+ * @param ballots a BallotStore, whose cursors are advanced
+ * @param shards the number of shards, 0 for one per core
+ * @param rounds a vector of VotingRound, replaced by one per round
+ * @return a vector of string, the same as voting_eval returns
+ */
+vector<string> voting_eval_sharded (vector<Candidate> candidates, BallotStore& ballots, int shards, vector<VotingRound>& rounds)
+{
+    return voting_eval_sharded_of<true>(candidates, ballots, shards, &rounds);
+}
+
+// ------------
+// OnlineElection
+// ------------
+
+/**
+ * start an election with no ballots
+ * @param names the candidates' names, the first at position 1
+ */
+OnlineElection::OnlineElection (const vector<string>& names) : ballots(names.size() < 1 ? 1 : names.size())
+{
+    if(names.size() < 1 || names.size() > 255)
+    {
+        throw out_of_range("OnlineElection::OnlineElection");
+    }
+    for(int i = 0; i < (int)names.size(); ++i)
+    {
+        candidates.push_back(Candidate(names.at(i), i + 1));
+    }
+    counted = false;
+    recounts = 0;
+}
+
+/**
+ * add a batch of ballots, each ranking every candidate exactly once;
+ * a batch with a bad ballot is rejected whole
+ * @param batch a vector of rankings, as voting_read returns them
+ */
+void OnlineElection::add_ballots (const vector< vector<int> >& batch)
+{
+    int n = candidates.size();
+    vector<int> seen(n + 1, -1);
+    for(int b = 0; b < (int)batch.size(); ++b)
+    {
+        const vector<int>& ranking = batch.at(b);
+        if((int)ranking.size() != n)
+        {
+            throw invalid_argument("ballot " + to_string(b + 1) + ": wrong number of preferences");
+        }
+        for(int r = 0; r < n; ++r)
+        {
+            if(ranking.at(r) < 1 || ranking.at(r) > n || seen.at(ranking.at(r)) == b)
+            {
+                throw invalid_argument("ballot " + to_string(b + 1) + ": not a ranking of every candidate");
+            }
+            seen.at(ranking.at(r)) = b;
+        }
+    }
+    for(int b = 0; b < (int)batch.size(); ++b)
+    {
+        const vector<int>& ranking = batch.at(b);
+        ballots.merge(ranking);
+        if(counted)
+        {
+            //count the ballot in every round, for its first preference still standing
+            int r = 0;
+            for(int round = 0; round < (int)tallies.size(); ++round)
+            {
+                while(out.at(ranking.at(r)) < round)
+                {
+                    ++r;
+                }
+                ++tallies.at(round).at(ranking.at(r));
+            }
+        }
+    }
+}
+
+/**
+ * replay the last count's rounds on the current tallies
+ * @return true if every round still eliminates the same candidates and the last still has winners
+ */
+bool OnlineElection::still_counted ()
+{
+    int total = ballots.get_total();
+    for(int round = 0; round < (int)tallies.size(); ++round)
+    {
+        vector<Candidate> standing;
+        for(int i = 0; i < (int)candidates.size(); ++i)
+        {
+            int p = candidates.at(i).get_position();
+            if(out.at(p) >= round)
+            {
+                standing.push_back(candidates.at(i));
+                standing.back().set_count(tallies.at(round).at(p));
+            }
+        }
+        vector<Candidate> winning = get_winners(standing, total);
+        if(round + 1 == (int)tallies.size())
+        {
+            if(winning.empty())
+            {
+                return false;
+            }
+            winners.clear();
+            for(int i = 0; i < (int)winning.size(); ++i)
+            {
+                winners.push_back(winning.at(i).get_name());
+            }
+            return true;
+        }
+        if(!winning.empty())
+        {
+            return false;
+        }
+        vector<int> losers = remove_losers(standing, total);
+        int eliminated = 0;
+        for(int i = 0; i < (int)out.size(); ++i)
+        {
+            eliminated += out.at(i) == round;
+        }
+        if((int)losers.size() != eliminated)
+        {
+            return false;
+        }
+        for(int i = 0; i < (int)losers.size(); ++i)
+        {
+            if(out.at(losers.at(i)) != round)
+            {
+                return false;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * count every ballot again, round by round, and keep each round's tally
+ */
+void OnlineElection::recount ()
+{
+    ++recounts;
+    vector<Candidate> first = candidates;
+    ballots.rewind();
+    voting_count(first, ballots, 1);
+    vector<VotingRound> rounds;
+    winners = voting_eval(first, ballots, rounds);
+    ballots.rewind();
+    int n = candidates.size();
+    tallies.assign(rounds.size(), vector<int>(n + 1, 0));
+    out.assign(n + 1, rounds.size());
+    for(int round = 0; round < (int)rounds.size(); ++round)
+    {
+        const vector<Candidate>& standing = rounds.at(round).tallies;
+        for(int i = 0; i < (int)standing.size(); ++i)
+        {
+            tallies.at(round).at(standing.at(i).get_position()) = standing.at(i).get_count();
+            if(round + 1 < (int)rounds.size() && find_candidate_index(rounds.at(round + 1).tallies, standing.at(i).get_position()) == -1)
+            {
+                out.at(standing.at(i).get_position()) = round;
+            }
+        }
+    }
+    counted = true;
+}
+
+/**
+ * @return the winners, the same as voting_eval on every ballot added so far
+ */
+vector<string> OnlineElection::current_result ()
+{
+    if(!counted || !still_counted())
+    {
+        recount();
+    }
+    return winners;
+}
+
+// ------------
+// voting_count
+// ------------
+
+/**
+ * count the first preferences of the stored ballots, one shard per thread
+ * @param candidates a vector of Candidate, whose counts are replaced
+ * @param ballots a BallotStore
+ * @param shards the number of shards, 0 for one per core
+ */
+void voting_count (vector<Candidate>& candidates, const BallotStore& ballots, int shards)
+{
+    shards = shard_count(shards, ballots.size());
+    vector< vector<int> > tallies(shards, vector<int>(ballots.get_width() + 1, 0));
+    run_shards(shards, [&](int s)
+    {
+        vector<int>& tally = tallies.at(s);
+        int last = (long long)ballots.size() * (s + 1) / shards;
+        for(int b = (long long)ballots.size() * s / shards; b < last; ++b)
+        {
+            int preference = ballots.get_preference(b);
+            if(preference > 0 && preference < (int)tally.size())
+            {
+                tally[preference] += ballots.get_weight(b);
+            }
+        }
+    });
+    for(int i = 0; i < (int)candidates.size(); ++i)
+    {
+        int count = 0;
+        for(int s = 0; s < shards; ++s)
+        {
+            if(candidates.at(i).get_position() > 0 && candidates.at(i).get_position() < (int)tallies.at(s).size())
+            {
+                count += tallies.at(s).at(candidates.at(i).get_position());
+            }
+        }
+        candidates.at(i).set_count(count);
+    }
+}
+
+// ------------
+// voting_eval_speedup
+// ------------
+
+/**
+ * time the serial count and voting_eval against voting_count and voting_eval_sharded
+ * @param candidates a vector of Candidate
+ * @param ballots a BallotStore, rewound before each run
+ * @param shards the number of shards, 0 for one per core
+ * @return the serial time divided by the sharded time
+ */
+double voting_eval_speedup (const vector<Candidate>& candidates, BallotStore& ballots, int shards)
+{
+    typedef chrono::steady_clock clock;
+    vector<Candidate> serial = candidates;
+    ballots.rewind();
+    clock::time_point start = clock::now();
+    for(int i = 0; i < (int)serial.size(); ++i)
+    {
+        serial.at(i).set_count(0);
+    }
+    vector<int> standing = index_standing(serial, ballots.get_width() + 1);
+    for(int b = 0; b < ballots.size(); ++b)
+    {
+        int preference = ballots.get_preference(b);
+        if(preference > 0 && preference < (int)standing.size() && standing.at(preference) != -1)
+        {
+            Candidate& c = serial.at(standing.at(preference));
+            c.set_count(c.get_count() + ballots.get_weight(b));
+        }
+    }
+    vector<string> expected = voting_eval(serial, ballots);
+    clock::duration serialTime = clock::now() - start;
+
+    vector<Candidate> sharded = candidates;
+    ballots.rewind();
+    start = clock::now();
+    voting_count(sharded, ballots, shards);
+    vector<string> actual = voting_eval_sharded(sharded, ballots, shards);
+    clock::duration shardedTime = clock::now() - start;
+    if(actual != expected)
+    {
+        throw logic_error("voting_eval_sharded differs from voting_eval");
+    }
+    return chrono::duration<double>(serialTime).count() / chrono::duration<double>(shardedTime).count();
+}
+
+// ------------
+// voting_generate
+// ------------
+
+// splitmix64: a small generator whose output is the same on every platform,
+// unlike the distributions of <random>
+static unsigned long long next_random (unsigned long long& state) {
+    unsigned long long z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);}
+
+static void shuffle_ranking (unsigned char* ranking, int n, unsigned long long& state) {
+    for(int i = n - 1; i > 0; --i)
+    {
+        int j = next_random(state) % (i + 1);
+        unsigned char t = ranking[i];
+        ranking[i] = ranking[j];
+        ranking[j] = t;
+    }}
+
+static unsigned long long gcd (unsigned long long a, unsigned long long b) {
+    return b == 0 ? a : gcd(b, a % b);}
+
+// one ballot of the text format, its ranks in decimal separated by spaces
+static void write_ranking_line (ostream& w, string& line, const unsigned char* ranking, int n, bool last) {
+    line.clear();
+    for(int r = 0; r < n; ++r)
+    {
+        int rank = ranking[r];
+        if(rank >= 100)
+        {
+            line += '0' + rank / 100;
+        }
+        if(rank >= 10)
+        {
+            line += '0' + rank / 10 % 10;
+        }
+        line += '0' + rank % 10;
+        line += r + 1 < n ? ' ' : '\n';
+    }
+    //the text format has no newline after the last ballot
+    w.write(line.data(), line.size() - last);}
+
+/**
+ * make a seeded synthetic election one ranking at a time
+ * @param n the number of candidates
+ * @param count the number of ballots
+ * @param distribution as for voting_generate
+ * @param seed a seed; the same seed always gives the same rankings
+ * @param emit called with each ranking of n candidates, which it must copy to keep
+ */
+template <typename Emit>
+static void generate_rankings (int n, int count, const string& distribution, unsigned long long seed, Emit emit)
+{
+    unsigned long long state = seed;
+    unsigned char ranking[255];
+    if(distribution == "uniform")
+    {
+        for(int b = 0; b < count; ++b)
+        {
+            for(int i = 0; i < n; ++i)
+            {
+                ranking[i] = i + 1;
+            }
+            shuffle_ranking(ranking, n, state);
+            emit(ranking);
+        }
+    }
+    else if(distribution == "clustered")
+    {
+        //three blocs of 50%, 30% and 20%, each voter a few swaps away from their bloc
+        unsigned char blocs[3][255];
+        for(int k = 0; k < 3; ++k)
+        {
+            for(int i = 0; i < n; ++i)
+            {
+                blocs[k][i] = i + 1;
+            }
+            shuffle_ranking(blocs[k], n, state);
+        }
+        for(int b = 0; b < count; ++b)
+        {
+            int pick = next_random(state) % 10;
+            memcpy(ranking, blocs[pick < 5 ? 0 : pick < 8 ? 1 : 2], n);
+            for(int s = 0; s < n / 4; ++s)
+            {
+                unsigned long long r = next_random(state);
+                int i = r % n;
+                if(i + 1 < n && (r >> 32) % 2 == 0)
+                {
+                    unsigned char t = ranking[i];
+                    ranking[i] = ranking[i + 1];
+                    ranking[i + 1] = t;
+                }
+            }
+            emit(ranking);
+        }
+    }
+    else if(distribution == "adversarial")
+    {
+        //candidates 1 to n-2 get d, 2d, 3d, ... first preferences and every ballot
+        //ranks candidate n second, so each round's loser is alone at the bottom
+        //and its votes go to n, which starts at 2d and never falls below the next;
+        //n-1 holds what n ends with, so the last of the n-1 rounds is a tie
+        //when count is even; d is at least 1 once count >= (n-1)(n-2)+4
+        vector<long long> last(n);
+        long long ladder = (long long)(n - 2) * (n - 1) / 2;
+        long long d = n < 2 ? 0 : count / (2 * (2 + ladder));
+        long long rest = count - 2 * d * (2 + ladder);
+        long long given = 0;
+        for(int k = 0; k + 2 < n; ++k)
+        {
+            given += (k + 1) * d;
+            last.at(k) = given;
+        }
+        if(n >= 2)
+        {
+            last.at(n - 2) = given + d * (2 + ladder) + rest / 2;
+        }
+        last.at(n - 1) = count;
+        //visit the ballots in a scattered order, so every shard sees every candidate
+        unsigned long long stride = count / 2 + 1;
+        while(count > 1 && gcd(stride, count) != 1)
+        {
+            ++stride;
+        }
+        for(int b = 0; b < count; ++b)
+        {
+            long long t = (unsigned long long)b * stride % count;
+            int first = 0;
+            while(t >= last.at(first))
+            {
+                ++first;
+            }
+            ranking[0] = first + 1;
+            int r = 1;
+            if(first != n - 1)
+            {
+                ranking[r++] = n;
+            }
+            for(int i = 0; i < n - 1; ++i)
+            {
+                if(i != first)
+                {
+                    ranking[r++] = i + 1;
+                }
+            }
+            emit(ranking);
+        }
+    }
+    else if(distribution == "tied")
+    {
+        //ballot b is one shuffled ranking rotated to start at its (b % n)th
+        //candidate, so every candidate has count / n first preferences and
+        //the count % n rotations left over lift the first few by one
+        unsigned char order[255];
+        for(int i = 0; i < n; ++i)
+        {
+            order[i] = i + 1;
+        }
+        shuffle_ranking(order, n, state);
+        for(int b = 0; b < count; ++b)
+        {
+            for(int i = 0; i < n; ++i)
+            {
+                ranking[i] = order[(b + i) % n];
+            }
+            emit(ranking);
+        }
+    }
+    else
+    {
+        throw invalid_argument("unknown distribution " + distribution);
+    }
+}
+
+/**
+ * add a seeded synthetic election to a BallotStore
+ * @param ballots a BallotStore, as wide as the number of candidates
+ * @param count the number of ballots to add
+ * @param distribution "uniform", "clustered" (a few blocs of similar rankings),
+ *        "adversarial" (one candidate eliminated per round for n-1 rounds, the last
+ *        a tie when count is even and won by candidate n when it is odd; this needs
+ *        count >= (n-1)(n-2)+4, with fewer the weakest candidates go out together)
+ *        or "tied" (rotations of one ranking: an n-way tie when n divides count,
+ *        otherwise the n - count % n candidates one vote short go out together)
+ * @param seed a seed; the same seed always gives the same ballots
+ */
+void voting_generate (BallotStore& ballots, int count, const string& distribution, unsigned long long seed)
+{
+    ballots.reserve(ballots.size() + count);
+    generate_rankings(ballots.get_width(), count, distribution, seed, [&](const unsigned char* ranking)
+    {
+        ballots.add(ranking);
+    });
+}
+
+/**
+ * write seeded synthetic elections in the text format
+ * @param w an ostream
+ * @param cases the number of cases
+ * @param n the number of candidates in each case
+ * @param count the number of ballots in each case
+ * @param distribution as for voting_generate
+ * @param seed a seed; the same seed always gives the same text
+ */
+void voting_generate (ostream& w, int cases, int n, int count, const string& distribution, unsigned long long seed)
+{
+    if(distribution != "uniform" && distribution != "clustered" && distribution != "adversarial" && distribution != "tied")
+    {
+        throw invalid_argument("unknown distribution " + distribution);
+    }
+    w << cases << "\n";
+    string line;
+    for(int currentCase = 0; currentCase < cases; ++currentCase)
+    {
+        w << "\n" << n << "\n";
+        for(int i = 1; i <= n; ++i)
+        {
+            w << "Candidate " << i << "\n";
+        }
+        //each ballot goes straight to w, so no case is ever held in memory
+        int b = 0;
+        generate_rankings(n, count, distribution, seed + currentCase, [&](const unsigned char* ranking)
+        {
+            write_ranking_line(w, line, ranking, n, currentCase + 1 == cases && ++b == count);
+        });
+    }
+}
+
+// ------------
+// find_candidate_index
+// ------------
+
+/**
+ * read a vector of Candidate and an integer
+ * @param candidates a vector of Candidate
+ * @param preference an integer
+ * @return a vector of Candidate
+ */
+int find_candidate_index(const vector<Candidate>& candidates, int preference)
+{
+    for(int i = 0 ; i < candidates.size(); ++i)
+    {
+        if(candidates.at(i).get_position() == preference)
+        {
+            return i;
+        }
+    }
+    return -1;
+} 
+
+// ------------
+// index_standing
+// ------------
+
+/**
+ * map each candidate position to its index in candidates
+ * @param candidates a vector of the standing Candidate
+ * @param size the number of positions to map
+ * @return a vector of indices, -1 for an eliminated position
+ */
+vector<int> index_standing(const vector<Candidate>& candidates, int size)
+{
+    vector<int> standing(size, -1);
+    for(int i = 0 ; i < (int)candidates.size(); ++i)
+    {
+        if(candidates.at(i).get_position() > 0 && candidates.at(i).get_position() < size)
+        {
+            standing.at(candidates.at(i).get_position()) = i;
+        }
+    }
+    return standing;
+}
+
+// ------------
+// get_winners
+// ------------
+
+/**
+ * read a vector of Candidate and an integer
+ * @param candidates a vector of Candidate
+ * @param ballotCount an integer
+ * @return a vector of Candidate
+ */
+vector<Candidate> get_winners(vector<Candidate> candidates, int ballotCount)
+{
+    int winnersCount = 0;
+    int tiedVotes = -1;
+    vector<Candidate> winner;
+    if(ballotCount % candidates.size() == 0)
+    {
+        tiedVotes = ballotCount/candidates.size();
+    }
+    for(int i = 0; i <candidates.size(); ++i)
+    {
+        if(candidates.at(i).get_count() > ballotCount/2)
+        {
+            winner.push_back(candidates.at(i));
+            return winner;
+        }
+        if(candidates.at(i).get_count() == tiedVotes)
+        {
+            ++winnersCount;
+        }
+    }
+    if(candidates.size() == winnersCount)
+    {
+        return candidates;
+    }
+    return winner;
+}
+
+// -------------
+// voting_print
+// -------------
+
+/**
+ * print three ints
+ * @param w an ostream
+ * @param names a vector of string
+ * @param isEOF a Boolean
+ */
+void voting_print (ostream& w, vector<string> names, bool isEOF) {
+    for(int i = 0; i < names.size(); ++i)
+    {
+        
+        if(isEOF)
+        {
+            w << names.at(i) << endl;
+        }
+        else
+        {
+            if(i != names.size()-1)
+            {
+                w << names.at(i) << endl;
+            }
+            else
+            {
+                w << names.at(i) << endl << endl;
+            }
+        }
+    }
+}
+
+// -------------
+// voting_trace
+// -------------
+
+static void write_json (ostream& w, const string& text) {
+    static const char hex[] = "0123456789abcdef";
+    w << '"';
+    for(int i = 0; i < (int)text.size(); ++i)
+    {
+        unsigned char c = text.at(i);
+        if(c == '"' || c == '\\')
+        {
+            w << '\\' << c;
+        }
+        else if(c < 0x20)
+        {
+            w << "\\u00" << hex[c >> 4] << hex[c & 15];
+        }
+        else
+        {
+            w << c;
+        }
+    }
+    w << '"';}
+
+/**
+ * write the rounds of one case as JSON lines, one object per round
+ * @param w an ostream
+ * @param currentCase the case number, from 1
+ * @param rounds a vector of VotingRound, from voting_eval
+ */
+void voting_trace (ostream& w, int currentCase, const vector<VotingRound>& rounds) {
+    for(int i = 0; i < (int)rounds.size(); ++i)
+    {
+        const VotingRound& round = rounds.at(i);
+        w << "{\"case\":" << currentCase << ",\"round\":" << round.round << ",\"tallies\":[";
+        for(int c = 0; c < (int)round.tallies.size(); ++c)
+        {
+            w << (c == 0 ? "{\"candidate\":" : ",{\"candidate\":");
+            write_json(w, round.tallies.at(c).get_name());
+            w << ",\"votes\":" << round.tallies.at(c).get_count() << "}";
+        }
+        w << "],\"eliminated\":[";
+        for(int c = 0; c < (int)round.eliminated.size(); ++c)
+        {
+            if(c != 0)
+            {
+                w << ",";
+            }
+            write_json(w, round.eliminated.at(c));
+        }
+        w << "],\"transferred\":" << round.transferred << ",\"skipped\":" << round.skipped
+          << ",\"count_seconds\":" << round.count_seconds << ",\"transfer_seconds\":" << round.transfer_seconds << "}\n";
+    }}
+
+// -------------
+// voting_solve
+// -------------
+
+/**
+ * @param r an istream
+ * @param w an ostream
+ */
+void voting_solve (istream& r, ostream& w) {
+    string firstLine;
+    getline(r,firstLine);
+    //cout << "first line1s == " <<endl;
+    //cout << "first line == " << firstLine <<endl;
+    int testCases = stoi(firstLine);
+    getline(r,firstLine); //skip the next blank line
+    int currentCase = 0;
+    while (currentCase < testCases)
+    {
+        vector <Candidate> candidates;
+        string s;
+        int counter = 1;
+        getline(r,s);
+        int cases = stoi (s);
+        BallotStore ballots(cases);
+        while (counter <= cases)
+        {
+            getline(r,s);
+            Candidate c(s, counter);
+            candidates.push_back(c);
+            counter++;
+        }
+        if(!r.eof())
+        {
+            getline(r,s);
+        }
+        while (!r.eof() && s.compare("") != 0)
+        {
+            vector<int> votes;
+            votes = voting_read(s, cases);
+            ballots.add(votes);
+            candidates.at(votes.at(0)-1).increase(); //incresing the vote count of the candidate
+            getline(r,s);
+        } 
+        if(r.eof())
+        {
+            vector<int> votes;
             votes = voting_read(s, cases);
-            Ballot b(votes);
-            ballots.push_back(b);
+            ballots.add(votes);
             candidates.at(votes.at(0)-1).increase();
         }
-        voting_print(w, voting_eval(candidates, ballots), r.eof());
-        ++currentCase;
+        voting_print(w, voting_eval(candidates, ballots), r.eof());
+        ++currentCase;
+    }
+
+}
+
+// ------------
+// scanning
+// ------------
+
+// Helpers for the buffer path: each works on [p, end) of a single input
+// buffer and never copies a line out of it.
+
+static const char* skip_blanks (const char* p, const char* end) {
+    while(p != end && (*p == ' ' || *p == '\t' || *p == '\r'))
+    {
+        ++p;
+    }
+    return p;}
+
+static const char* line_end (const char* p, const char* end) {
+    const char* e = static_cast<const char*>(memchr(p, '\n', end - p));
+    return e == 0 ? end : e;}
+
+static const char* next_line (const char* e, const char* end) {
+    return e == end ? end : e + 1;}
+
+static bool only_blank_lines (const char* p, const char* end) {
+    while(p != end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+    {
+        ++p;
+    }
+    return p == end;}
+
+static void scan_error (const char* begin, const char* p, const string& what) {
+    int line = 1;
+    for(const char* q = begin; q != p; ++q)
+    {
+        if(*q == '\n')
+        {
+            ++line;
+        }
+    }
+    ostringstream message;
+    message << "line " << line << ": " << what;
+    throw invalid_argument(message.str());}
+
+/**
+ * read a whole line holding a single positive integer
+ * @return the integer, or -1 if the line holds anything else
+ */
+static int scan_count (const char* p, const char* e) {
+    p = skip_blanks(p, e);
+    int value = 0;
+    if(p == e || *p < '0' || *p > '9')
+    {
+        return -1;
+    }
+    while(p != e && *p >= '0' && *p <= '9')
+    {
+        value = value * 10 + (*p - '0');
+        if(value > 1000000000)
+        {
+            return -1;
+        }
+        ++p;
+    }
+    return skip_blanks(p, e) == e ? value : -1;}
+
+// ------------
+// voting_scan_case
+// ------------
+
+/**
+ * parse one case straight into candidates and ballots, validating each ranking
+ * @param begin the start of the input, for line numbers in errors
+ * @param p the start of the case
+ * @param end one past the end of the input
+ * @param candidates a vector of Candidate, given their first-preference counts
+ * @param ballots a BallotStore, replaced by one as wide as the case
+ * @param options a VotingOptions, for strict and aggregate
+ * @return the start of the next case
+ */
+const char* voting_scan_case (const char* begin, const char* p, const char* end, vector<Candidate>& candidates, BallotStore& ballots, const VotingOptions& options)
+{
+    //skip the blank lines before the case
+    const char* q = skip_blanks(p, end);
+    while(q != end && *q == '\n')
+    {
+        p = q + 1;
+        q = skip_blanks(p, end);
+    }
+    if(q == end)
+    {
+        scan_error(begin, p, "missing case");
+    }
+    const char* e = line_end(p, end);
+    int cases = scan_count(p, e);
+    if(cases < 1 || cases > 255)
+    {
+        scan_error(begin, p, "bad number of candidates");
+    }
+    p = next_line(e, end);
+
+    candidates.clear();
+    for(int counter = 1; counter <= cases; ++counter)
+    {
+        if(p == end)
+        {
+            scan_error(begin, p, "missing candidate name");
+        }
+        e = line_end(p, end);
+        candidates.push_back(Candidate(string(p, e), counter));
+        p = next_line(e, end);
+    }
+
+    ballots = BallotStore(cases);
+    vector<int> seen(cases + 1, 0);
+    unsigned char ranking[255];
+    int ballot = 0;
+    while(p != end)
+    {
+        e = line_end(p, end);
+        q = skip_blanks(p, e);
+        if(q == e)
+        {
+            //a blank line ends the case
+            return next_line(e, end);
+        }
+        ++ballot;
+        int count = 0;
+        while(q != e)
+        {
+            if(*q < '0' || *q > '9')
+            {
+                scan_error(begin, q, "unexpected character in ballot");
+            }
+            int vote = 0;
+            while(q != e && *q >= '0' && *q <= '9')
+            {
+                vote = vote < 256 ? vote * 10 + (*q - '0') : vote;
+                ++q;
+            }
+            if(vote < 1 || vote > cases)
+            {
+                scan_error(begin, q, "ranking out of range");
+            }
+            if(count == cases)
+            {
+                scan_error(begin, q, "too many rankings in ballot");
+            }
+            if(options.strict && seen.at(vote) == ballot)
+            {
+                scan_error(begin, q, "duplicate ranking in ballot");
+            }
+            seen.at(vote) = ballot;
+            ranking[count++] = vote;
+            q = skip_blanks(q, e);
+        }
+        if(count < cases)
+        {
+            scan_error(begin, q, "short ballot");
+        }
+        if(options.aggregate)
+        {
+            ballots.merge(ranking);
+        }
+        else
+        {
+            ballots.add(ranking);
+        }
+        candidates.at(ranking[0]-1).increase();
+        p = next_line(e, end);
+    }
+    return p;
+}
+
+/**
+ * evaluate one scanned case the way options asks, and report its statistics and rounds
+ */
+static vector<string> solve_case (vector<Candidate>& candidates, BallotStore& ballots, const VotingOptions& options, int currentCase, ostream* report, ostream* trace)
+{
+    if(report != 0)
+    {
+        *report << "case " << currentCase << ": " << ballots.get_total() << " ballots, "
+                << ballots.size() << " rankings, compression " << ballots.compression() << ", "
+                << ballots.bytes_per_ballot() << " bytes per ballot" << endl;
+    }
+    if(trace != 0)
+    {
+        vector<VotingRound> rounds;
+        vector<string> names = options.shards == 1 ? voting_eval(candidates, ballots, rounds) : voting_eval_sharded(candidates, ballots, options.shards, rounds);
+        voting_trace(*trace, currentCase, rounds);
+        return names;
+    }
+    if(options.shards == 1)
+    {
+        return voting_eval(candidates, ballots);
+    }
+    return voting_eval_sharded(candidates, ballots, options.shards);
+}
+
+/**
+ * solve every case held in a buffer, without copying it line by line
+ * @param begin the start of the input
+ * @param end one past the end of the input
+ * @param w an ostream
+ * @param options a VotingOptions; threads is ignored
+ */
+void voting_solve (const char* begin, const char* end, ostream& w, const VotingOptions& options) {
+    const char* e = line_end(begin, end);
+    int testCases = scan_count(begin, e);
+    if(testCases < 0)
+    {
+        scan_error(begin, begin, "bad number of cases");
+    }
+    const char* p = next_line(e, end);
+    vector <Candidate> candidates;
+    BallotStore ballots(1);
+    for(int currentCase = 0; currentCase < testCases; ++currentCase)
+    {
+        p = voting_scan_case(begin, p, end, candidates, ballots, options);
+        voting_print(w, solve_case(candidates, ballots, options, currentCase + 1, options.report, options.trace), only_blank_lines(p, end));
+    }
+}
+
+// -------------
+// voting_split_case
+// -------------
+
+/**
+ * find where a case ends without parsing its ballots
+ * @param p the start of the case
+ * @param end one past the end of the input
+ * @return the start of the next case, or end if the case is malformed
+ */
+const char* voting_split_case (const char* p, const char* end)
+{
+    //the same boundaries as voting_scan_case, without looking inside the lines
+    const char* q = skip_blanks(p, end);
+    while(q != end && *q == '\n')
+    {
+        p = q + 1;
+        q = skip_blanks(p, end);
+    }
+    if(q == end)
+    {
+        return end;
+    }
+    const char* e = line_end(p, end);
+    int cases = scan_count(p, e);
+    if(cases < 1 || cases > 255)
+    {
+        return end;
+    }
+    p = next_line(e, end);
+    for(int counter = 1; counter <= cases; ++counter)
+    {
+        if(p == end)
+        {
+            return end;
+        }
+        p = next_line(line_end(p, end), end);
+    }
+    while(p != end)
+    {
+        e = line_end(p, end);
+        if(skip_blanks(p, e) == e)
+        {
+            return next_line(e, end);
+        }
+        p = next_line(e, end);
+    }
+    return end;
+}
+
+// -------------
+// voting_solve_parallel
+// -------------
+
+//! SplitCase.
+/*!
+	One case of the input, as handed from the splitter to a worker
+	and from the worker to the writer.
+*/
+struct SplitCase
+{
+	const char* begin;
+	const char* end;
+	bool isEOF;
+	bool done;
+	string output;
+	string report;
+	string trace;
+	exception_ptr error;
+
+	SplitCase(const char* b, const char* e, bool eof)
+	{
+		begin = b;
+		end = e;
+		isEOF = eof;
+		done = false;
+	}
+};
+
+/**
+ * solve the cases held in a buffer on a pool of threads, printing in input order
+ * @param begin the start of the input
+ * @param end one past the end of the input
+ * @param w an ostream
+ * @param options a VotingOptions, giving the number of worker threads
+ */
+void voting_solve_parallel (const char* begin, const char* end, ostream& w, const VotingOptions& options)
+{
+    int threads = options.threads;
+    if(threads <= 0)
+    {
+        threads = thread::hardware_concurrency();
+    }
+    if(threads <= 1)
+    {
+        voting_solve(begin, end, w, options);
+        return;
+    }
+    const char* e = line_end(begin, end);
+    int testCases = scan_count(begin, e);
+    if(testCases < 0)
+    {
+        scan_error(begin, begin, "bad number of cases");
+    }
+
+    deque<SplitCase> cases;  // references stay valid as the splitter appends
+    mutex lock;
+    condition_variable work; // a case was split, or the writer moved on
+    condition_variable done; // a case was solved
+    int split = 0;
+    int taken = 0;
+    int written = 0;
+    bool splitting = true;
+    bool stop = false;
+    const int window = 4 * threads; // cases solved ahead of the writer
+
+    thread splitter([&]()
+    {
+        const char* p = next_line(e, end);
+        for(int currentCase = 0; currentCase < testCases; ++currentCase)
+        {
+            const char* q = voting_split_case(p, end);
+            unique_lock<mutex> guard(lock);
+            if(stop)
+            {
+                break;
+            }
+            cases.push_back(SplitCase(p, q, only_blank_lines(q, end)));
+            ++split;
+            work.notify_one();
+            if(p == end)
+            {
+                //this case is missing, so its worker reports the error
+                break;
+            }
+            p = q;
+        }
+        unique_lock<mutex> guard(lock);
+        splitting = false;
+        work.notify_all();
+    });
+
+    vector<thread> workers;
+    for(int i = 0; i < threads; ++i)
+    {
+        workers.push_back(thread([&]()
+        {
+            unique_lock<mutex> guard(lock);
+            while(true)
+            {
+                while(!stop && (taken == split || taken >= written + window) && (splitting || taken < split))
+                {
+                    work.wait(guard);
+                }
+                if(stop || taken == split)
+                {
+                    return;
+                }
+                int currentCase = ++taken;
+                SplitCase& c = cases.at(currentCase - 1);
+                guard.unlock();
+                try
+                {
+                    vector<Candidate> candidates;
+                    BallotStore ballots(1);
+                    voting_scan_case(begin, c.begin, c.end, candidates, ballots, options);
+                    ostringstream out;
+                    ostringstream report;
+                    ostringstream trace;
+                    voting_print(out, solve_case(candidates, ballots, options, currentCase, options.report != 0 ? &report : 0, options.trace != 0 ? &trace : 0), c.isEOF);
+                    c.output = out.str();
+                    c.report = report.str();
+                    c.trace = trace.str();
+                }
+                catch(...)
+                {
+                    c.error = current_exception();
+                }
+                guard.lock();
+                c.done = true;
+                done.notify_all();
+            }
+        }));
+    }
+
+    exception_ptr error;
+    while(written < testCases)
+    {
+        unique_lock<mutex> guard(lock);
+        while(written >= split || !cases.at(written).done)
+        {
+            done.wait(guard);
+        }
+        SplitCase& c = cases.at(written);
+        guard.unlock();
+        if(c.error)
+        {
+            error = c.error;
+            break;
+        }
+        if(options.report != 0)
+        {
+            *options.report << c.report;
+        }
+        if(options.trace != 0)
+        {
+            *options.trace << c.trace;
+            string().swap(c.trace);
+        }
+        w << c.output;
+        string().swap(c.output);
+        guard.lock();
+        ++written;
+        work.notify_all();
+    }
+
+    {
+        unique_lock<mutex> guard(lock);
+        stop = true;
+        work.notify_all();
+    }
+    splitter.join();
+    for(int i = 0; i < (int)workers.size(); ++i)
+    {
+        workers.at(i).join();
+    }
+    if(error)
+    {
+        rethrow_exception(error);
+    }
+}
+
+// -------------
+// voting_solve_file
+// -------------
+
+/**
+ * map a file, or read it when it cannot be mapped
+ * @param path the path of the file
+ */
+MappedFile::MappedFile (const string& path)
+{
+    map = 0;
+    length = 0;
+    fd = open(path.c_str(), O_RDONLY);
+    if(fd == -1)
+    {
+        throw runtime_error(strerror(errno));
+    }
+    struct stat st;
+    if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map == MAP_FAILED)
+        {
+            map = 0;
+        }
+        else
+        {
+            length = st.st_size;
+            madvise(map, length, MADV_SEQUENTIAL);
+            return;
+        }
+    }
+    const size_t chunk = 1 << 20;
+    ssize_t got;
+    do
+    {
+        copy.resize(length + chunk);
+        got = read(fd, &copy[length], chunk);
+        if(got > 0)
+        {
+            length += got;
+        }
+    }
+    while(got > 0 || (got == -1 && errno == EINTR));
+    if(got == -1)
+    {
+        int error = errno;
+        close(fd);
+        throw runtime_error(strerror(error));
+    }
+}
+
+MappedFile::~MappedFile ()
+{
+    if(map != 0)
+    {
+        munmap(map, length);
+    }
+    close(fd);
+}
+
+/**
+ * map a file into memory and solve the cases in it, as text or as a binary ballot file
+ * @param path the path of the input file
+ * @param w an ostream
+ * @param options a VotingOptions
+ */
+void voting_solve_file (const string& path, ostream& w, const VotingOptions& options) {
+    MappedFile file(path);
+    if(voting_is_binary(file.begin(), file.end()))
+    {
+        voting_solve_binary(file.begin(), file.end(), w, options);
+        return;
+    }
+    voting_solve_parallel(file.begin(), file.end(), w, options);}
+
+// -------------
+// binary ballot files
+// -------------
+
+// A binary ballot file holds the same cases as the text format, little-endian:
+//
+//   file:  "VOTB", u32 version (2), u32 number of cases, u32 0
+//   case:  u64 bytes in the case, including this field
+//          u8 n, u8 bits per rank, u32 number of ballots
+//          n x (u16 length, name bytes)
+//          ballots x n ranks of bits each, low bit first, padded to a byte
+//   tail:  at least one spare byte and padding to 8 bytes
+//
+// With n <= 20 a rank fits in 5 bits, so a ballot takes 12.5 bytes. There are
+// no first-preference counts; the reader takes them from the ranks themselves.
+
+static const char binary_magic[4] = {'V', 'O', 'T', 'B'};
+static const int binary_version = 2;
+static const int binary_header = 16;
+static const int binary_case_header = 14;
+
+static void put (ostream& w, unsigned long long value, int bytes) {
+    for(int i = 0; i < bytes; ++i)
+    {
+        w.put(static_cast<char>((value >> (8 * i)) & 0xff));
+    }}
+
+static unsigned long long get (const unsigned char* p, int bytes) {
+    unsigned long long value = 0;
+    for(int i = bytes - 1; i >= 0; --i)
+    {
+        value = value << 8 | p[i];
+    }
+    return value;}
+
+static int rank_bits (int n) {
+    int bits = 1;
+    while((1 << bits) <= n)
+    {
+        ++bits;
+    }
+    return bits;}
+
+static size_t padded (size_t bytes) {
+    return (bytes + 7) & ~(size_t)7;}
+
+static size_t packed_bytes (size_t ballots, int n, int bits) {
+    return (ballots * n * bits + 7) / 8;}
+
+static void binary_error (const string& what) {
+    throw invalid_argument("binary ballot file: " + what);}
+
+/**
+ * check whether a buffer starts like a binary ballot file
+ * @param begin the start of the input
+ * @param end one past the end of the input
+ * @return a Boolean
+ */
+bool voting_is_binary (const char* begin, const char* end) {
+    return end - begin >= binary_header && memcmp(begin, binary_magic, 4) == 0;}
+
+/**
+ * convert cases in the text format to a binary ballot file
+ * @param begin the start of the text input
+ * @param end one past the end of the text input
+ * @param w an ostream, opened in binary mode
+ */
+void voting_encode (const char* begin, const char* end, ostream& w)
+{
+    const char* e = line_end(begin, end);
+    int testCases = scan_count(begin, e);
+    if(testCases < 0)
+    {
+        scan_error(begin, begin, "bad number of cases");
+    }
+    w.write(binary_magic, 4);
+    put(w, binary_version, 4);
+    put(w, testCases, 4);
+    put(w, 0, 4);
+
+    const char* p = next_line(e, end);
+    vector <Candidate> candidates;
+    BallotStore ballots(1);
+    size_t total = binary_header;
+    for(int currentCase = 0; currentCase < testCases; ++currentCase)
+    {
+        p = voting_scan_case(begin, p, end, candidates, ballots);
+        int n = candidates.size();
+        int bits = rank_bits(n);
+        size_t names = 0;
+        for(int i = 0; i < n; ++i)
+        {
+            names += 2 + candidates.at(i).get_name().size();
+        }
+        size_t bytes = binary_case_header + names + packed_bytes(ballots.size(), n, bits);
+        put(w, bytes, 8);
+        put(w, n, 1);
+        put(w, bits, 1);
+        put(w, ballots.size(), 4);
+        for(int i = 0; i < n; ++i)
+        {
+            string name = candidates.at(i).get_name();
+            if(name.size() > 65535)
+            {
+                binary_error("candidate name too long");
+            }
+            put(w, name.size(), 2);
+            w.write(name.data(), name.size());
+        }
+
+        //pack the ranks low bit first, flushing whole bytes as they fill
+        unsigned int word = 0;
+        int filled = 0;
+        for(int b = 0; b < ballots.size(); ++b)
+        {
+            for(int r = 0; r < n; ++r)
+            {
+                word |= ballots.get_rank(b, r) << filled;
+                filled += bits;
+                while(filled >= 8)
+                {
+                    w.put(static_cast<char>(word & 0xff));
+                    word >>= 8;
+                    filled -= 8;
+                }
+            }
+        }
+        if(filled > 0)
+        {
+            w.put(static_cast<char>(word & 0xff));
+        }
+        total += bytes;
+    }
+    //PackedBallots reads two bytes at a time, so the last rank needs one after it
+    put(w, 0, padded(total + 1) - total);
+}
+
+//! BinaryCase.
+/*!
+	The header fields of one case of a binary ballot file, checked
+	against the bounds of the buffer it was read from, and candidates
+	holding the first-preference counts of its ranks.
+*/
+struct BinaryCase
+{
+	int n;
+	int bits;
+	int ballots;
+	vector<Candidate> candidates;
+	const unsigned char* packed;
+	const unsigned char* next;
+};
+
+static BinaryCase read_binary_case (const unsigned char* p, const unsigned char* end)
+{
+    BinaryCase c;
+    if(end - p < binary_case_header)
+    {
+        binary_error("truncated case");
     }
+    unsigned long long bytes = get(p, 8);
+    c.n = p[8];
+    c.bits = p[9];
+    unsigned long long ballots = get(p + 10, 4);
+    if(bytes < (unsigned long long)binary_case_header || bytes > (unsigned long long)(end - p) || c.n < 1 || c.bits != rank_bits(c.n) || ballots > 2147483647ull)
+    {
+        binary_error("bad case header");
+    }
+    c.ballots = ballots;
+    c.next = p + bytes;
+    const unsigned char* q = p + binary_case_header;
+    for(int i = 0; i < c.n; ++i)
+    {
+        if(q + 2 > c.next || q + 2 + get(q, 2) > c.next)
+        {
+            binary_error("truncated candidate name");
+        }
+        int length = get(q, 2);
+        c.candidates.push_back(Candidate(string(reinterpret_cast<const char*>(q) + 2, length), i + 1));
+        q += 2 + length;
+    }
+    c.packed = q;
+    size_t ranks = packed_bytes(c.ballots, c.n, c.bits);
+    if((size_t)(c.next - c.packed) != ranks || (size_t)(end - c.packed) <= ranks)
+    {
+        binary_error("truncated ballots");
+    }
+
+    //count first preferences, checking every rank on the way
+    vector<int> counts(c.n + 1, 0);
+    unsigned int word = 0;
+    int filled = 0;
+    for(int b = 0; b < c.ballots; ++b)
+    {
+        for(int r = 0; r < c.n; ++r)
+        {
+            while(filled < c.bits)
+            {
+                word |= *q++ << filled;
+                filled += 8;
+            }
+            int rank = word & ((1 << c.bits) - 1);
+            word >>= c.bits;
+            filled -= c.bits;
+            if(rank < 1 || rank > c.n)
+            {
+                binary_error("ranking out of range");
+            }
+            if(r == 0)
+            {
+                ++counts[rank];
+            }
+        }
+    }
+    for(int i = 0; i < c.n; ++i)
+    {
+        c.candidates.at(i).set_count(counts[i + 1]);
+    }
+    return c;
+}
+
+static int read_binary_header (const char* begin, const char* end)
+{
+    if(!voting_is_binary(begin, end))
+    {
+        binary_error("bad magic number");
+    }
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(begin);
+    if(get(p + 4, 4) != binary_version)
+    {
+        binary_error("unsupported version");
+    }
+    return get(p + 8, 4);
+}
+
+/**
+ * convert a binary ballot file back to the text format
+ * @param begin the start of the binary input
+ * @param end one past the end of the binary input
+ * @param w an ostream
+ */
+void voting_decode (const char* begin, const char* end, ostream& w)
+{
+    int testCases = read_binary_header(begin, end);
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(begin) + binary_header;
+    const unsigned char* stop = reinterpret_cast<const unsigned char*>(end);
+    w << testCases << "\n";
+    string line;
+    unsigned char ranking[255];
+    for(int currentCase = 0; currentCase < testCases; ++currentCase)
+    {
+        BinaryCase c = read_binary_case(p, stop);
+        w << "\n" << c.n << "\n";
+        for(int i = 0; i < c.n; ++i)
+        {
+            w << c.candidates.at(i).get_name() << "\n";
+        }
+        PackedBallots ballots(c.packed, c.n, c.bits, c.ballots);
+        for(int b = 0; b < c.ballots; ++b)
+        {
+            for(int r = 0; r < c.n; ++r)
+            {
+                ranking[r] = r == 0 ? ballots.get_preference(b) : ballots.next_preference(b);
+            }
+            write_ranking_line(w, line, ranking, c.n, currentCase + 1 == testCases && b + 1 == c.ballots);
+        }
+        p = c.next;
+    }
+}
+
+/**
+ * solve the cases of a binary ballot file held in memory, reading ballots in place
+ * @param begin the start of the binary input
+ * @param end one past the end of the binary input
+ * @param w an ostream
+ * @param options a VotingOptions; only trace is used
+ */
+void voting_solve_binary (const char* begin, const char* end, ostream& w, const VotingOptions& options)
+{
+    int testCases = read_binary_header(begin, end);
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(begin) + binary_header;
+    const unsigned char* stop = reinterpret_cast<const unsigned char*>(end);
+    for(int currentCase = 0; currentCase < testCases; ++currentCase)
+    {
+        BinaryCase c = read_binary_case(p, stop);
+        PackedBallots ballots(c.packed, c.n, c.bits, c.ballots);
+        if(options.trace != 0)
+        {
+            vector<VotingRound> rounds;
+            voting_print(w, voting_eval(c.candidates, ballots, rounds), currentCase + 1 == testCases);
+            voting_trace(*options.trace, currentCase + 1, rounds);
+        }
+        else
+        {
+            voting_print(w, voting_eval(c.candidates, ballots), currentCase + 1 == testCases);
+        }
+        p = c.next;
+    }
+}
 
-}
\ No newline at end of file
+// -------------
+// voting_speedup_file
+// -------------
+
+/**
+ * report, for each case of a file, how much faster the sharded tally is
+ * @param path the path of the input file
+ * @param w an ostream, given one line per case
+ * @param shards the number of shards, 0 for one per core
+ */
+void voting_speedup_file (const string& path, ostream& w, int shards) {
+    MappedFile file(path);
+    const char* e = line_end(file.begin(), file.end());
+    int testCases = scan_count(file.begin(), e);
+    if(testCases < 0)
+    {
+        scan_error(file.begin(), file.begin(), "bad number of cases");
+    }
+    const char* p = next_line(e, file.end());
+    vector <Candidate> candidates;
+    BallotStore ballots(1);
+    for(int currentCase = 1; currentCase <= testCases; ++currentCase)
+    {
+        p = voting_scan_case(file.begin(), p, file.end(), candidates, ballots);
+        double speedup = voting_eval_speedup(candidates, ballots, shards);
+        w << "case " << currentCase << ": " << ballots.get_total() << " ballots, "
+          << shard_count(shards, ballots.size()) << " shards, speedup " << speedup << endl;
+    }}
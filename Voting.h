@@ -10,9 +10,10 @@
 // includes
 // --------
 
-#include <iostream> // istream, ostream
-#include <string>   // string
-#include <utility>  // pair
+#include <iostream>  // istream, ostream
+#include <stdexcept> // out_of_range
+#include <string>    // string
+#include <utility>   // pair
 #include <vector>
 
 using namespace std;
@@ -31,9 +32,9 @@ private:
 	int vote_count;
 	int position;
 public:
-	string get_name(){return name;}
-	int get_count(){return vote_count;}
-	int get_position(){return position;}
+	string get_name() const {return name;}
+	int get_count() const {return vote_count;}
+	int get_position() const {return position;}
 	void set_count(int c){vote_count = c;}
 	void increase(){++vote_count;}
 
@@ -48,29 +49,288 @@ public:
 //! Ballot.
 /*!
 	Ballots by the people; stating their preference of the candidate.
-	This class defines a vector which stores the preference.
+	This class defines a vector which stores the preference,
+	and the index of the preference currently counted.
 */
 class Ballot
 {
 private:
 	vector<int> preference;
+	int current;
 public:
 	int get_preference()
 	{
-		return preference.at(0);
+		return preference.at(current);
 	}
 	int next_preference()
 	{
-		preference.erase(preference.begin()); 
-		return preference.at(0);
+		++current;
+		return preference.at(current);
 	}
 
 	Ballot(vector<int> pref)
 	{
 		preference = pref;
+		current = 0;
 	}
 };
 
+//! BallotStore.
+/*!
+	Every ballot of one election, stored back to back in a single arena.
+	Each ranking takes one byte per candidate, and each ballot keeps a
+	cursor to its current preference instead of erasing the ones it has passed.
+	Ballots added with merge() are collapsed into one weighted ballot per
+	distinct ranking; weights stays empty until then, and every ballot weighs 1.
+*/
+class BallotStore
+{
+private:
+	int width;
+	int total;
+	vector<unsigned char> rankings;
+	vector<unsigned char> cursor;
+	vector<int> weights;
+	vector<int> table;
+	void rehash(int slots);
+public:
+	int size() const {return cursor.size();}
+	int get_width() const {return width;}
+	int get_total() const {return total;}
+	int get_weight(int b) const
+	{
+		return weights.empty() ? 1 : weights.at(b);
+	}
+	int get_preference(int b) const
+	{
+		return rankings.at((size_t)b * width + cursor.at(b));
+	}
+	int get_rank(int b, int r) const
+	{
+		return rankings.at((size_t)b * width + r);
+	}
+	int next_preference(int b)
+	{
+		if(cursor.at(b) + 1 >= width)
+		{
+			throw out_of_range("BallotStore::next_preference");
+		}
+		++cursor.at(b);
+		return rankings.at((size_t)b * width + cursor.at(b));
+	}
+	void add(const unsigned char* pref)
+	{
+		rankings.insert(rankings.end(), pref, pref + width);
+		cursor.push_back(0);
+		if(!weights.empty())
+		{
+			weights.push_back(1);
+		}
+		table.clear(); // the next merge indexes this ballot too
+		++total;
+	}
+	void add(const vector<int>& pref)
+	{
+		for(int i = 0; i < width; ++i)
+		{
+			int p = i < (int)pref.size() ? pref.at(i) : 0;
+			if(p < 0 || p > 255)
+			{
+				throw out_of_range("BallotStore::add");
+			}
+			rankings.push_back(p);
+		}
+		cursor.push_back(0);
+		if(!weights.empty())
+		{
+			weights.push_back(1);
+		}
+		table.clear(); // the next merge indexes this ballot too
+		++total;
+	}
+	void merge(const unsigned char* pref);
+	void merge(const vector<int>& pref);
+	void reserve(int ballots)
+	{
+		rankings.reserve((size_t)ballots * width);
+		cursor.reserve(ballots);
+	}
+	void rewind() {cursor.assign(cursor.size(), 0);}
+	double bytes_per_ballot() const
+	{
+		if(total == 0)
+		{
+			return width + 1;
+		}
+		return (double)(rankings.capacity() + cursor.capacity() + (weights.capacity() + table.capacity()) * sizeof(int)) / total;
+	}
+	double compression() const
+	{
+		return size() == 0 ? 1 : (double)total / size();
+	}
+
+	BallotStore(int n)
+	{
+		if(n < 1 || n > 255)
+		{
+			throw out_of_range("BallotStore::BallotStore");
+		}
+		width = n;
+		total = 0;
+	}
+};
+
+//! PackedBallots.
+/*!
+	The ballots of one case of a binary ballot file, read in place.
+	Each ranking takes bits bits, packed low bit first, so a file mapped into
+	memory is evaluated without copying; only the cursors are allocated.
+*/
+class PackedBallots
+{
+private:
+	const unsigned char* data;
+	int width;
+	int bits;
+	int count;
+	vector<unsigned char> cursor;
+	int rank(int b, int r) const
+	{
+		size_t bit = ((size_t)b * width + r) * bits;
+		unsigned int word = data[bit >> 3] | (data[(bit >> 3) + 1] << 8);
+		return (word >> (bit & 7)) & ((1 << bits) - 1);
+	}
+public:
+	int size() const {return count;}
+	int get_width() const {return width;}
+	int get_total() const {return count;}
+	int get_preference(int b) const
+	{
+		return rank(b, cursor.at(b));
+	}
+	int next_preference(int b)
+	{
+		if(cursor.at(b) + 1 >= width)
+		{
+			throw out_of_range("PackedBallots::next_preference");
+		}
+		++cursor.at(b);
+		return rank(b, cursor.at(b));
+	}
+	void rewind() {cursor.assign(count, 0);}
+
+	PackedBallots(const unsigned char* packed, int n, int rankBits, int ballots)
+	{
+		data = packed;
+		width = n;
+		bits = rankBits;
+		count = ballots;
+		cursor.assign(count, 0);
+	}
+};
+
+//! MappedFile.
+/*!
+	A read-only view of a whole file: mapped when the file allows it,
+	otherwise read into memory in large chunks.
+*/
+class MappedFile
+{
+private:
+	int fd;
+	void* map;
+	size_t length;
+	vector<char> copy;
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+public:
+	const char* begin() const {return map != 0 ? static_cast<const char*>(map) : copy.data();}
+	const char* end() const {return begin() + length;}
+
+	MappedFile(const string& path);
+	~MappedFile();
+};
+
+//! VotingOptions.
+/*!
+	How the buffer and file paths read, evaluate and report their cases.
+*/
+struct VotingOptions
+{
+	bool strict;     // reject ballots that repeat a candidate
+	bool aggregate;  // merge identical rankings into one weighted ballot
+	int threads;     // cases solved at once, 0 for one per core
+	int shards;      // threads tallying each case, 1 for the serial voting_eval
+	ostream* report; // if set, given a line of ballot statistics per case
+	ostream* trace;  // if set, given a JSON line per elimination round
+
+	VotingOptions()
+	{
+		strict = false;
+		aggregate = false;
+		threads = 1;
+		shards = 1;
+		report = 0;
+		trace = 0;
+	}
+};
+
+//! VotingRound.
+/*!
+	What one round of an election did: the tally it began with,
+	who it eliminated and what the transfers cost.
+	Only the voting_eval overloads given a vector of them fill it in.
+*/
+struct VotingRound
+{
+	int round;                 // 1 for the first count
+	vector<Candidate> tallies; // the standing candidates and their votes
+	vector<string> eliminated; // empty in the last round, which has winners
+	long long transferred;     // votes moved off the eliminated candidates
+	long long skipped;         // preferences passed over for candidates already out
+	double count_seconds;      // counting and looking for winners; the first round includes sorting every ballot
+	double transfer_seconds;   // eliminating and transferring
+
+	VotingRound()
+	{
+		round = 0;
+		transferred = 0;
+		skipped = 0;
+		count_seconds = 0;
+		transfer_seconds = 0;
+	}
+};
+
+//! OnlineElection.
+/*!
+	One election whose ballots arrive in batches, with its result wanted after each.
+	The tally of every round of the last count is kept, so a batch is added
+	round by round in time proportional to its size; the whole election is
+	recounted only when the batch changes who is eliminated in some round.
+	current_result() always equals voting_eval on the same ballots.
+*/
+class OnlineElection
+{
+private:
+	vector<Candidate> candidates;   // names and positions, in input order
+	BallotStore ballots;            // every ballot so far, identical rankings merged
+	vector< vector<int> > tallies;  // votes by position, for each round of the last count
+	vector<int> out;                // the round each position was eliminated in, by position
+	vector<string> winners;
+	bool counted;                   // whether tallies and out describe the ballots
+	int recounts;
+	void recount();
+	bool still_counted();
+public:
+	void add_ballots(const vector< vector<int> >& batch);
+	vector<string> current_result();
+	int get_total() const {return ballots.get_total();}
+	int get_rounds() const {return tallies.size();}
+	int get_recounts() const {return recounts;}
+
+	OnlineElection(const vector<string>& names);
+};
+
 // ------------
 // voting_read
 // ------------
@@ -95,6 +355,117 @@ vector<int> voting_read (const string& s, int size);
  */
 vector<string> voting_eval (vector<Candidate> candidates, vector<Ballot> ballots);
 
+/**
+ * read a vector of Candidate and a BallotStore
+ * @param candidates a vector of Candidate
+ * @param ballots a BallotStore, whose cursors are advanced
+ * @return a vector of string
+ */
+vector<string> voting_eval (vector<Candidate> candidates, BallotStore& ballots);
+
+/**
+ * read a vector of Candidate and the PackedBallots of a binary ballot file
+ * @param candidates a vector of Candidate
+ * @param ballots a PackedBallots, whose cursors are advanced
+ * @return a vector of string
+ */
+vector<string> voting_eval (vector<Candidate> candidates, PackedBallots& ballots);
+
+/**
+ * read a vector of Candidate and a BallotStore, recording every round
+ * @param candidates a vector of Candidate
+ * @param ballots a BallotStore, whose cursors are advanced
+ * @param rounds a vector of VotingRound, replaced by one per round
+ * @return a vector of string
+ */
+vector<string> voting_eval (vector<Candidate> candidates, BallotStore& ballots, vector<VotingRound>& rounds);
+
+/**
+ * read a vector of Candidate and the PackedBallots of a binary ballot file, recording every round
+ * @param candidates a vector of Candidate
+ * @param ballots a PackedBallots, whose cursors are advanced
+ * @param rounds a vector of VotingRound, replaced by one per round
+ * @return a vector of string
+ */
+vector<string> voting_eval (vector<Candidate> candidates, PackedBallots& ballots, vector<VotingRound>& rounds);
+
+// ------------
+// voting_eval_sharded
+// ------------
+
+/**
+ * evaluate one election with its ballots split into shards, tallied by one thread each
+ * @param candidates a vector of Candidate
+ * @param ballots a BallotStore, whose cursors are advanced
+ * @param shards the number of shards, 0 for one per core
+ * @return a vector of string, the same as voting_eval returns
+ */
+vector<string> voting_eval_sharded (vector<Candidate> candidates, BallotStore& ballots, int shards);
+
+/**
+ * evaluate one election with its ballots split into shards, recording every round
+ * @param candidates a vector of Candidate
+ * @param ballots a BallotStore, whose cursors are advanced
+ * @param shards the number of shards, 0 for one per core
+ * @param rounds a vector of VotingRound, replaced by one per round
+ * @return a vector of string, the same as voting_eval returns
+ */
+vector<string> voting_eval_sharded (vector<Candidate> candidates, BallotStore& ballots, int shards, vector<VotingRound>& rounds);
+
+// ------------
+// voting_count
+// ------------
+
+/**
+ * count the first preferences of the stored ballots, one shard per thread
+ * @param candidates a vector of Candidate, whose counts are replaced
+ * @param ballots a BallotStore
+ * @param shards the number of shards, 0 for one per core
+ */
+void voting_count (vector<Candidate>& candidates, const BallotStore& ballots, int shards);
+
+// ------------
+// voting_eval_speedup
+// ------------
+
+/**
+ * time the serial count and voting_eval against voting_count and voting_eval_sharded
+ * @param candidates a vector of Candidate
+ * @param ballots a BallotStore, rewound before each run
+ * @param shards the number of shards, 0 for one per core
+ * @return the serial time divided by the sharded time
+ */
+double voting_eval_speedup (const vector<Candidate>& candidates, BallotStore& ballots, int shards);
+
+// ------------
+// voting_generate
+// ------------
+
+/**
+ * add a seeded synthetic election to a BallotStore
+ * @param ballots a BallotStore, as wide as the number of candidates
+ * @param count the number of ballots to add
+ * @param distribution "uniform", "clustered" (a few blocs of similar rankings),
+ *        "adversarial" (one candidate eliminated per round for n-1 rounds, the last
+ *        a tie when count is even and won by candidate n when it is odd; this needs
+ *        count >= (n-1)(n-2)+4, with fewer the weakest candidates go out together)
+ *        or "tied" (rotations of one ranking: an n-way tie when n divides count,
+ *        otherwise the n - count % n candidates one vote short go out together)
+ * @param seed a seed; the same seed always gives the same ballots
+ */
+void voting_generate (BallotStore& ballots, int count, const string& distribution, unsigned long long seed);
+
+/**
+ * write seeded synthetic elections in the text format
+ * @param w an ostream
+ * @param cases the number of cases
+ * @param n the number of candidates in each case
+ * @param count the number of ballots in each case
+ * @param distribution as for voting_generate
+ * @param seed a seed; the same seed always gives the same text
+ */
+void voting_generate (ostream& w, int cases, int n, int count, const string& distribution, unsigned long long seed);
+
 // -------------
 // voting_print
 // -------------
@@ -107,6 +478,18 @@ vector<string> voting_eval (vector<Candidate> candidates, vector<Ballot> ballots
  */
 void voting_print (ostream& w, vector<string> names, bool isEOF);
 
+// -------------
+// voting_trace
+// -------------
+
+/**
+ * write the rounds of one case as JSON lines, one object per round
+ * @param w an ostream
+ * @param currentCase the case number, from 1
+ * @param rounds a vector of VotingRound, from voting_eval
+ */
+void voting_trace (ostream& w, int currentCase, const vector<VotingRound>& rounds);
+
 // -------------
 // voting_solve
 // -------------
@@ -117,6 +500,129 @@ void voting_print (ostream& w, vector<string> names, bool isEOF);
  */
 void voting_solve (istream& r, ostream& w);
 
+/**
+ * solve every case held in a buffer, without copying it line by line
+ * @param begin the start of the input
+ * @param end one past the end of the input
+ * @param w an ostream
+ * @param options a VotingOptions; threads is ignored
+ */
+void voting_solve (const char* begin, const char* end, ostream& w, const VotingOptions& options = VotingOptions());
+
+// -------------
+// voting_solve_parallel
+// -------------
+
+/**
+ * solve the cases held in a buffer on a pool of threads, printing in input order
+ * @param begin the start of the input
+ * @param end one past the end of the input
+ * @param w an ostream
+ * @param options a VotingOptions, giving the number of worker threads
+ */
+void voting_solve_parallel (const char* begin, const char* end, ostream& w, const VotingOptions& options);
+
+// -------------
+// voting_solve_file
+// -------------
+
+/**
+ * map a file into memory and solve the cases in it, as text or as a binary ballot file
+ * @param path the path of the input file
+ * @param w an ostream
+ * @param options a VotingOptions
+ */
+void voting_solve_file (const string& path, ostream& w, const VotingOptions& options = VotingOptions());
+
+// -------------
+// voting_encode
+// -------------
+
+/**
+ * convert cases in the text format to a binary ballot file
+ * @param begin the start of the text input
+ * @param end one past the end of the text input
+ * @param w an ostream, opened in binary mode
+ */
+void voting_encode (const char* begin, const char* end, ostream& w);
+
+// -------------
+// voting_decode
+// -------------
+
+/**
+ * convert a binary ballot file back to the text format
+ * @param begin the start of the binary input
+ * @param end one past the end of the binary input
+ * @param w an ostream
+ */
+void voting_decode (const char* begin, const char* end, ostream& w);
+
+// -------------
+// voting_solve_binary
+// -------------
+
+/**
+ * solve the cases of a binary ballot file held in memory, reading ballots in place
+ * @param begin the start of the binary input
+ * @param end one past the end of the binary input
+ * @param w an ostream
+ * @param options a VotingOptions; only trace is used
+ */
+void voting_solve_binary (const char* begin, const char* end, ostream& w, const VotingOptions& options = VotingOptions());
+
+// -------------
+// voting_is_binary
+// -------------
+
+/**
+ * check whether a buffer starts like a binary ballot file
+ * @param begin the start of the input
+ * @param end one past the end of the input
+ * @return a Boolean
+ */
+bool voting_is_binary (const char* begin, const char* end);
+
+// -------------
+// voting_speedup_file
+// -------------
+
+/**
+ * report, for each case of a file, how much faster the sharded tally is
+ * @param path the path of the input file
+ * @param w an ostream, given one line per case
+ * @param shards the number of shards, 0 for one per core
+ */
+void voting_speedup_file (const string& path, ostream& w, int shards);
+
+// -------------
+// voting_split_case
+// -------------
+
+/**
+ * find where a case ends without parsing its ballots
+ * @param p the start of the case
+ * @param end one past the end of the input
+ * @return the start of the next case, or end if the case is malformed
+ */
+const char* voting_split_case (const char* p, const char* end);
+
+// -------------
+// voting_scan_case
+// -------------
+
+/**
+ * parse one case straight into candidates and ballots, validating each ranking
+ * @param begin the start of the input, for line numbers in errors
+ * @param p the start of the case
+ * @param end one past the end of the input
+ * @param candidates a vector of Candidate, given their first-preference counts
+ * @param ballots a BallotStore, replaced by one as wide as the case
+ * @param options a VotingOptions, for strict and aggregate
+ * @return the start of the next case
+ */
+const char* voting_scan_case (const char* begin, const char* p, const char* end, vector<Candidate>& candidates, BallotStore& ballots, const VotingOptions& options = VotingOptions());
+
 // ------------
 // get_winners
 // ------------
@@ -140,6 +646,53 @@ vector<Candidate> get_winners(vector<Candidate> candidates, int ballotCount);
  */
 void eliminate_losers(vector<Candidate>& candidates, vector<Ballot>& ballots);
 
+/**
+ * eliminate the losers and transfer only the ballots counted for them
+ * @param candidates a vector of the standing Candidate
+ * @param ballots a vector of Ballots
+ * @param buckets ballot indices indexed by the position they are counted for
+ * @param moving ballot indices not counted for any standing candidate
+ */
+void eliminate_losers(vector<Candidate>& candidates, vector<Ballot>& ballots, vector< vector<int> >& buckets, vector<int>& moving);
+
+/**
+ * read a vector of Candidate and a BallotStore
+ * @param candidates a vector of Candidate
+ * @param ballots a BallotStore
+ */
+void eliminate_losers(vector<Candidate>& candidates, BallotStore& ballots);
+
+/**
+ * eliminate the losers and transfer only the ballots counted for them
+ * @param candidates a vector of the standing Candidate
+ * @param ballots a BallotStore
+ * @param buckets ballot indices indexed by the position they are counted for
+ * @param moving ballot indices not counted for any standing candidate
+ */
+void eliminate_losers(vector<Candidate>& candidates, BallotStore& ballots, vector< vector<int> >& buckets, vector<int>& moving);
+
+// ------------
+// fill_buckets
+// ------------
+
+/**
+ * sort each ballot under the candidate its current preference counts for
+ * @param candidates a vector of the standing Candidate
+ * @param ballots a vector of Ballots
+ * @param buckets ballot indices indexed by candidate position
+ * @param moving ballot indices whose preference is not a standing candidate
+ */
+void fill_buckets(const vector<Candidate>& candidates, vector<Ballot>& ballots, vector< vector<int> >& buckets, vector<int>& moving);
+
+/**
+ * sort each stored ballot under the candidate its current preference counts for
+ * @param candidates a vector of the standing Candidate
+ * @param ballots a BallotStore
+ * @param buckets ballot indices indexed by candidate position
+ * @param moving ballot indices whose preference is not a standing candidate
+ */
+void fill_buckets(const vector<Candidate>& candidates, const BallotStore& ballots, vector< vector<int> >& buckets, vector<int>& moving);
+
 // ------------
 // find_candidate_index
 // ------------
@@ -150,6 +703,18 @@ void eliminate_losers(vector<Candidate>& candidates, vector<Ballot>& ballots);
  * @param preference an integer
  * @return a vector of Candidate
  */
-int find_candidate_index(vector<Candidate> candidates, int preference);
+int find_candidate_index(const vector<Candidate>& candidates, int preference);
+
+// ------------
+// index_standing
+// ------------
+
+/**
+ * map each candidate position to its index in candidates
+ * @param candidates a vector of the standing Candidate
+ * @param size the number of positions to map
+ * @return a vector of indices, -1 for an eliminated position
+ */
+vector<int> index_standing(const vector<Candidate>& candidates, int size);
 
 #endif // Voting_h